@@ -0,0 +1,80 @@
+#include <string>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <iostream>
+#include <boost/asio.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <udho/router.h>
+#include <udho/server.h>
+#include <udho/contexts.h>
+#include <udho/io_pool.h>
+#include <udho/endpoint.h>
+
+// new connections/sec, each client connects, sends one GET with Connection: close and reads the response,
+// for 1, 2, 4 .. N accepts kept pending on the listening socket
+// usage: udho-benchmark-accept [max pending accepts] [seconds per run] [clients] [threads]
+
+std::string hello(udho::contexts::stateless ctx){
+    return "Hello World";
+}
+
+std::size_t hammer(unsigned short port, std::chrono::steady_clock::time_point until){
+    namespace http = boost::beast::http;
+    boost::asio::io_context io;
+    boost::asio::ip::tcp::endpoint endpoint(boost::asio::ip::make_address("127.0.0.1"), port);
+    http::request<http::empty_body> req{http::verb::get, "/hello", 11};
+    req.set(http::field::host, "localhost");
+    req.keep_alive(false);
+    std::size_t count = 0;
+    while(std::chrono::steady_clock::now() < until){
+        boost::system::error_code ec;
+        boost::asio::ip::tcp::socket socket(io);
+        socket.connect(endpoint, ec);
+        if(ec) continue;
+        http::write(socket, req, ec);
+        if(ec) continue;
+        boost::beast::flat_buffer buffer;
+        http::response<http::string_body> res;
+        http::read(socket, buffer, res, ec);
+        if(ec) continue;
+        ++count;
+    }
+    return count;
+}
+
+int main(int argc, char** argv){
+    unsigned max_accepts = argc > 1 ? std::stoul(argv[1]) : 16;
+    unsigned seconds     = argc > 2 ? std::stoul(argv[2]) : 3;
+    unsigned clients     = argc > 3 ? std::stoul(argv[3]) : 32;
+    unsigned threads     = argc > 4 ? std::stoul(argv[4]) : 1;
+
+    auto router = udho::router() | (udho::get(&hello).plain() = "^/hello$");
+
+    std::cout << "accepts" << "\t" << "connections/sec" << std::endl;
+    for(unsigned accepts = 1; accepts <= max_accepts; accepts *= 2){
+        unsigned short port = 19298 + accepts;
+        udho::io_pool pool(threads);
+        udho::servers::quiet::stateless server(pool.context(0));
+        server.serve(router, pool, {udho::endpoint::tcp4(port, "127.0.0.1").backlog(4096).accepts(accepts)});
+        pool.start();
+
+        std::atomic<std::size_t> total(0);
+        std::vector<std::thread> workers;
+        auto until = std::chrono::steady_clock::now() + std::chrono::seconds(seconds);
+        for(unsigned i = 0; i < clients; ++i){
+            workers.emplace_back([&total, port, until](){
+                total += hammer(port, until);
+            });
+        }
+        for(std::thread& worker: workers){
+            worker.join();
+        }
+        pool.stop();
+        pool.join();
+        std::cout << accepts << "\t" << (total / seconds) << std::endl;
+    }
+    return 0;
+}
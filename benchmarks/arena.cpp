@@ -0,0 +1,91 @@
+#include <new>
+#include <string>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <cstdlib>
+#include <iostream>
+#include <boost/optional.hpp>
+#include <boost/asio/buffer.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <udho/arena.h>
+#include <udho/defs.h>
+
+// heap allocations and time per request of parsing a request and composing the headers of its response,
+// with the fields on the global heap and with the fields in a udho::arena rewound between requests as a keep-alive connection does
+// usage: udho-benchmark-arena [iterations]
+
+static std::atomic<std::size_t> allocations(0);
+
+void* operator new(std::size_t size){
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    void* p = std::malloc(size ? size : 1);
+    if(!p) throw std::bad_alloc();
+    return p;
+}
+void operator delete(void* p) noexcept{
+    std::free(p);
+}
+void operator delete(void* p, std::size_t) noexcept{
+    std::free(p);
+}
+
+namespace http = boost::beast::http;
+
+static const std::string raw = 
+    "GET /records/42?sort=name&order=asc HTTP/1.1\r\n"
+    "Host: localhost:9198\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/120.0 Safari/537.36\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+    "Accept-Encoding: gzip, deflate, br\r\n"
+    "Accept-Language: en-US,en;q=0.9\r\n"
+    "Cookie: UDHOSESSID=0a1b2c3d4e5f; theme=dark\r\n"
+    "Connection: keep-alive\r\n"
+    "\r\n";
+
+template <typename AllocatorT>
+std::size_t exchange(const AllocatorT& allocator){
+    typedef http::basic_fields<AllocatorT> fields_type;
+    http::request_parser<http::string_body, AllocatorT> parser(std::piecewise_construct, std::make_tuple(), std::make_tuple(allocator));
+    boost::beast::error_code ec;
+    parser.put(boost::asio::buffer(raw), ec);
+    http::request<http::string_body, fields_type> req = parser.release();
+    http::response<http::empty_body, fields_type> res{std::piecewise_construct, std::make_tuple(), std::make_tuple(allocator)};
+    res.result(http::status::ok);
+    res.version(req.version());
+    res.set(http::field::server, UDHO_VERSION_STRING);
+    res.set(http::field::content_type, "text/html");
+    res.keep_alive(req.keep_alive());
+    return req.target().size() + res.count(http::field::server);
+}
+
+template <typename F>
+void measure(const std::string& name, std::size_t iterations, F f){
+    std::size_t checksum = 0;
+    std::size_t before = allocations.load();
+    auto start = std::chrono::steady_clock::now();
+    for(std::size_t i = 0; i < iterations; ++i){
+        checksum += f();
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    std::size_t count = allocations.load() - before;
+    std::cout << name << "\t" << (double(count) / iterations) << "\t" << (elapsed.count() / iterations) << "\t" << checksum << std::endl;
+}
+
+int main(int argc, char** argv){
+    std::size_t iterations = argc > 1 ? std::stoul(argv[1]) : 100000;
+    
+    std::shared_ptr<udho::arena> arena = std::make_shared<udho::arena>();
+    udho::arena_allocator<char> allocator(arena);
+    
+    std::cout << "fields" << "\t" << "allocations/request" << "\t" << "ns/request" << "\t" << "checksum" << std::endl;
+    measure("heap", iterations, [](){
+        return exchange(std::allocator<char>());
+    });
+    measure("arena", iterations, [&arena, &allocator](){
+        arena->reset();
+        return exchange(allocator);
+    });
+    return 0;
+}
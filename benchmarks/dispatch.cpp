@@ -0,0 +1,92 @@
+#include <string>
+#include <chrono>
+#include <vector>
+#include <iostream>
+#include <boost/asio.hpp>
+#include <udho/router.h>
+#include <udho/radix.h>
+#include <udho/server.h>
+#include <udho/contexts.h>
+
+// dispatches/sec of the linear overload chain, the per verb index and the radix tree on a router
+// with 64 url mappings spread over GET, POST, PUT and DELETE, without any network io
+// usage: udho-benchmark-dispatch [iterations]
+
+typedef udho::servers::quiet::stateless server_type;
+typedef udho::contexts::stateless context_type;
+
+std::string resource(context_type ctx, int id){
+    return "ok";
+}
+
+struct discard{
+    template <typename MessageT>
+    void operator()(MessageT&&) const{}
+};
+
+template <std::size_t N>
+struct routes{
+    template <typename RouterT>
+    static auto attach(const RouterT& router){
+        static const boost::beast::http::verb verbs[] = {
+            boost::beast::http::verb::get,
+            boost::beast::http::verb::post,
+            boost::beast::http::verb::put,
+            boost::beast::http::verb::delete_
+        };
+        return routes<N-1>::attach(router) | (udho::content_wrapper0<decltype(&resource)>(verbs[N % 4], &resource).plain() = "^/resource"+std::to_string(N)+"/(\\d+)$");
+    }
+};
+
+template <>
+struct routes<0>{
+    template <typename RouterT>
+    static auto attach(const RouterT& router){
+        return router;
+    }
+};
+
+template <typename RouterT>
+double measure(RouterT& router, context_type& ctx, const std::vector<std::pair<boost::beast::http::verb, std::string>>& requests, std::size_t iterations){
+    std::size_t served = 0;
+    auto start = std::chrono::steady_clock::now();
+    for(std::size_t i = 0; i < iterations; ++i){
+        const auto& request = requests[i % requests.size()];
+        served += router.serve(ctx, request.first, request.second, discard()) == 200;
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    if(served != iterations){
+        std::cerr << "unexpected: " << iterations - served << " requests not served" << std::endl;
+    }
+    return iterations / elapsed.count();
+}
+
+int main(int argc, char** argv){
+    std::size_t iterations = argc > 1 ? std::stoul(argv[1]) : 200000;
+
+    auto linear = routes<64>::attach(udho::router());
+    auto indexed = udho::indexed(linear);
+    auto radix = udho::radix(linear);
+
+    static const boost::beast::http::verb verbs[] = {
+        boost::beast::http::verb::get,
+        boost::beast::http::verb::post,
+        boost::beast::http::verb::put,
+        boost::beast::http::verb::delete_
+    };
+    std::vector<std::pair<boost::beast::http::verb, std::string>> requests;
+    for(std::size_t i = 1; i <= 64; ++i){
+        requests.emplace_back(verbs[i % 4], "/resource"+std::to_string(i)+"/42");
+    }
+
+    boost::asio::io_service io;
+    context_type::request_type req;
+    server_type::attachment_type attachment(io);
+    context_type ctx(attachment.aux(), req, attachment);
+
+    std::cout << "router" << "\t" << "dispatches/sec" << std::endl;
+    std::cout << "linear"  << "\t" << static_cast<std::size_t>(measure(linear,  ctx, requests, iterations)) << std::endl;
+    std::cout << "indexed" << "\t" << static_cast<std::size_t>(measure(indexed, ctx, requests, iterations)) << std::endl;
+    std::cout << "radix"   << "\t" << static_cast<std::size_t>(measure(radix,   ctx, requests, iterations)) << std::endl;
+    return 0;
+}
@@ -0,0 +1,79 @@
+#include <string>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <iostream>
+#include <boost/asio.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <udho/router.h>
+#include <udho/server.h>
+#include <udho/contexts.h>
+#include <udho/io_pool.h>
+
+// requests/sec of a keep-alive GET served by an io_pool of 1 .. N io_contexts
+// usage: udho-benchmark-pool [max threads] [seconds per run] [clients per thread]
+
+std::string hello(udho::contexts::stateless ctx){
+    return "Hello World";
+}
+
+std::size_t hammer(unsigned short port, std::chrono::steady_clock::time_point until){
+    namespace http = boost::beast::http;
+    boost::asio::io_context io;
+    boost::asio::ip::tcp::socket socket(io);
+    boost::system::error_code ec;
+    socket.connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), port), ec);
+    if(ec){
+        return 0;
+    }
+    http::request<http::empty_body> req{http::verb::get, "/hello", 11};
+    req.set(http::field::host, "localhost");
+    req.keep_alive(true);
+    boost::beast::flat_buffer buffer;
+    std::size_t count = 0;
+    while(std::chrono::steady_clock::now() < until){
+        http::write(socket, req, ec);
+        if(ec) break;
+        http::response<http::string_body> res;
+        http::read(socket, buffer, res, ec);
+        if(ec) break;
+        ++count;
+    }
+    socket.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ec);
+    return count;
+}
+
+int main(int argc, char** argv){
+    unsigned max_threads = argc > 1 ? std::stoul(argv[1]) : std::max(1u, std::thread::hardware_concurrency());
+    unsigned seconds     = argc > 2 ? std::stoul(argv[2]) : 3;
+    unsigned clients     = argc > 3 ? std::stoul(argv[3]) : 4;
+
+    auto router = udho::router() | (udho::get(&hello).plain() = "^/hello$");
+
+    std::cout << "threads" << "\t" << "requests/sec" << std::endl;
+    for(unsigned threads = 1; threads <= max_threads; ++threads){
+        unsigned short port = 19198 + threads;
+        udho::io_pool pool(threads);
+        udho::servers::quiet::stateless server(pool.context(0));
+        server.serve(router, pool, port);
+        pool.start();
+
+        std::atomic<std::size_t> total(0);
+        std::vector<std::thread> workers;
+        auto until = std::chrono::steady_clock::now() + std::chrono::seconds(seconds);
+        for(unsigned i = 0; i < threads * clients; ++i){
+            workers.emplace_back([&total, port, until](){
+                total += hammer(port, until);
+            });
+        }
+        for(std::thread& worker: workers){
+            worker.join();
+        }
+        pool.stop();
+        pool.join();
+        std::cout << threads << "\t" << (total / seconds) << std::endl;
+    }
+    return 0;
+}
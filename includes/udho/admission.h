@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) 2020, Neel Basu <neel.basu.z@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <organization> nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Neel Basu <neel.basu.z@gmail.com> ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Neel Basu <neel.basu.z@gmail.com> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef UDHO_ADMISSION_H
+#define UDHO_ADMISSION_H
+
+#include <cmath>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <cstdint>
+
+namespace udho{
+
+/**
+ * admission control of the requests, shared by all connections and safe to use from all threads of an io_pool.
+ * Counts the requests in flight, so that the ones beyond `udho::configs::admission::requests` are answered with 503 Service Unavailable,
+ * and sheds requests with a CoDel controller once the time they waited before being dispatched stays above `udho::configs::admission::target`
+ * for longer than `udho::configs::admission::interval`.
+ * @code
+ * udho::admission& admission = server._attachment.aux().admission();
+ * admission.inflight(); admission.shedding();
+ * @endcode
+ * \ingroup server
+ */
+class admission{
+    typedef std::chrono::steady_clock clock_type;
+    typedef std::atomic<std::size_t>  counter_type;
+    
+    std::shared_ptr<counter_type> _inflight;
+    mutable std::mutex            _mutex;
+    clock_type::time_point        _above;    ///< when the delay will have stayed above the target for an interval, zero while it is below
+    clock_type::time_point        _next;     ///< when the next request is shed while shedding
+    std::uint32_t                 _count;    ///< requests shed since shedding started
+    std::uint32_t                 _last;     ///< requests shed in the previous shedding period
+    bool                          _shedding;
+  public:
+    /**
+     * a slot among the requests in flight, released once the response is written or the request is dropped
+     */
+    class ticket{
+        std::shared_ptr<counter_type> _inflight;
+      public:
+        ticket(){}
+        explicit ticket(std::shared_ptr<counter_type> inflight): _inflight(inflight){}
+        ticket(const ticket&) = delete;
+        ticket& operator=(const ticket&) = delete;
+        ticket(ticket&& other): _inflight(std::move(other._inflight)){}
+        ticket& operator=(ticket&& other){
+            if(this != &other){
+                release();
+                _inflight = std::move(other._inflight);
+            }
+            return *this;
+        }
+        ~ticket(){
+            release();
+        }
+        explicit operator bool() const{
+            return !!_inflight;
+        }
+        void release(){
+            if(_inflight){
+                _inflight->fetch_sub(1, std::memory_order_relaxed);
+                _inflight.reset();
+            }
+        }
+    };
+    
+    admission(): _inflight(std::make_shared<counter_type>(0)), _count(0), _last(0), _shedding(false){}
+    admission(const admission&) = delete;
+    admission& operator=(const admission&) = delete;
+    
+    /**
+     * takes a slot among the requests in flight
+     * @param limit maximum number of requests in flight, 0 for no limit
+     * @return an empty ticket if limit requests are already in flight
+     */
+    ticket enter(std::size_t limit){
+        std::size_t current = _inflight->load(std::memory_order_relaxed);
+        do{
+            if(limit && current >= limit){
+                return ticket();
+            }
+        }while(!_inflight->compare_exchange_weak(current, current + 1, std::memory_order_relaxed));
+        return ticket(_inflight);
+    }
+    /**
+     * number of requests in flight
+     */
+    std::size_t inflight() const{
+        return _inflight->load(std::memory_order_relaxed);
+    }
+    /**
+     * CoDel controller, decides whether a request that waited sojourn before being dispatched is served.
+     * Once the delay stayed above target for an interval a request is shed, and the next ones are shed
+     * at intervals shrinking with the square root of the number shed, until the delay falls below target again.
+     * @return false if the request has to be shed
+     */
+    bool admit(clock_type::duration sojourn, clock_type::duration target, clock_type::duration interval){
+        clock_type::time_point now = clock_type::now();
+        std::lock_guard<std::mutex> lock(_mutex);
+        if(sojourn < target){
+            _above = clock_type::time_point();
+            if(_shedding){
+                _shedding = false;
+                _last = _count;
+            }
+            return true;
+        }
+        if(_above == clock_type::time_point()){
+            _above = now + interval;
+            return true;
+        }
+        if(now < _above){
+            return true;
+        }
+        if(!_shedding){
+            _shedding = true;
+            // shedding again soon after the last period resumes near the rate it ended with
+            _count = (_last > 2 && now - _next < interval * 16) ? _last - 2 : 1;
+            _next  = now + spacing(interval, _count);
+            return false;
+        }
+        if(now >= _next){
+            ++_count;
+            _next += spacing(interval, _count);
+            return false;
+        }
+        return true;
+    }
+    /**
+     * whether the CoDel controller is shedding requests
+     */
+    bool shedding() const{
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _shedding;
+    }
+  private:
+    static clock_type::duration spacing(clock_type::duration interval, std::uint32_t count){
+        return std::chrono::duration_cast<clock_type::duration>(interval / std::sqrt(static_cast<double>(count)));
+    }
+};
+
+}
+
+#endif // UDHO_ADMISSION_H
@@ -20,6 +20,7 @@
 #include "util.h"
 #include <string>
 #include <functional>
+#include <utility>
 #include <boost/regex.hpp>
 #include <udho/router.h>
 #include <udho/util.h>
@@ -111,44 +112,54 @@ template <typename AppT, bool Ref=false>
 struct app_{
     typedef app_<AppT, Ref> self_type;
     typedef self_type application_type;
+    typedef decltype(std::declval<AppT&>().route(std::declval<udho::router&>())) routed_type; ///< overload chain of the application
     
-    std::string _path;
-    AppT        _app;
+    std::string          _path;
+    internal::regex_type _regex;
+    AppT                 _app;
+    routed_type          _routed;
     
     template <typename... T>
-    explicit app_(T... args): _app(args...){
-        _path = "^/"+_app.name();
+    explicit app_(T... args): _app(args...), _routed(route(_app)){
+        *this = "^/"+_app.name();
     }
+    /**
+     * the url mappings of the application are bound to the application instance, so they are routed again for the copied instance
+     */
+    app_(const self_type& other): _path(other._path), _regex(other._regex), _app(other._app), _routed(route(_app)){}
+    self_type& operator=(const self_type& other) = delete;
     std::string name() const{
         return _app.name();
     }
     self_type& operator=(const std::string& path){
-        _path = path;
+        _path  = path;
+        _regex = internal::compile_pattern(_path);
         return *this;
     }
     template <typename ContextT, typename Lambda>
     int serve(ContextT& ctx, boost::beast::http::verb request_method, const std::string& subject, Lambda send){
-        auto router = udho::router();
-        return _app.route(router).serve(ctx, request_method, subject, send);
+        return _routed.serve(ctx, request_method, subject, send);
     }
     void summary(std::vector<module_info>& stack) const{
-        auto router = udho::router();
         module_info info;
         info._pattern = _path;
         info._fptr = &_app;
         info._compositor = "APPLICATION";
         info._method = boost::beast::http::verb::unknown;
-        const_cast<AppT&>(_app).route(router).summary(info._children);
+        _routed.summary(info._children);
         stack.push_back(info);
     }
     template <typename F>
     void eval(F& fnc){
-        auto router = udho::router();
-        auto routed = _app.route(router);
 //         fnc(_app);
-        routed.eval(fnc);
+        _routed.eval(fnc);
         fnc();
     }
+  private:
+    static routed_type route(AppT& app){
+        auto router = udho::router();
+        return app.route(router);
+    }
 };
 
 /**
@@ -158,43 +169,48 @@ template <typename AppT>
 struct app_<AppT, true>{
     typedef app_<AppT, true> self_type;
     typedef self_type application_type;
+    typedef decltype(std::declval<AppT&>().route(std::declval<udho::router&>())) routed_type; ///< overload chain of the application
     
-    std::string _path;
-    AppT&       _app;
+    std::string          _path;
+    internal::regex_type _regex;
+    AppT&                _app;
+    routed_type          _routed;
     
-    explicit app_(AppT& app): _app(app){
-        _path = "^/"+_app.name();
+    explicit app_(AppT& app): _app(app), _routed(route(_app)){
+        *this = "^/"+_app.name();
     }
     std::string name() const{
         return _app.name();
     }
     self_type& operator=(const std::string& path){
-        _path = path;
+        _path  = path;
+        _regex = internal::compile_pattern(_path);
         return *this;
     }
     template <typename ContextT, typename Lambda>
     int serve(ContextT& ctx, boost::beast::http::verb request_method, const std::string& subject, Lambda send){
-        auto router = udho::router();
-        return _app.route(router).serve(ctx, request_method, subject, send);
+        return _routed.serve(ctx, request_method, subject, send);
     }
     void summary(std::vector<module_info>& stack) const{
-        auto router = udho::router();
         module_info info;
         info._pattern = _path;
         info._fptr = &_app;
         info._compositor = "APPLICATION";
         info._method = boost::beast::http::verb::unknown;
-        const_cast<AppT&>(_app).route(router).summary(info._children);
+        _routed.summary(info._children);
         stack.push_back(info);
     }
     template <typename F>
     void eval(F& fnc){
-        auto router = udho::router();
-        auto routed = _app.route(router);
 //         fnc(_app);
-        routed.eval(fnc);
+        _routed.eval(fnc);
         fnc();
     }
+  private:
+    static routed_type route(AppT& app){
+        auto router = udho::router();
+        return app.route(router);
+    }
 };
 
 /**
@@ -206,6 +222,7 @@ struct overload_group<U, app_<V, Ref>>{
     typedef U                           parent_type;
     typedef app_<V, Ref>                     overload_type;
     typedef typename parent_type::terminal_type terminal_type;
+    enum { depth = parent_type::depth + 1 };
     
     parent_type   _parent;
     overload_type _overload;
@@ -213,19 +230,45 @@ struct overload_group<U, app_<V, Ref>>{
     overload_group(const parent_type& parent, const overload_type& overload): _parent(parent), _overload(overload){}
     template <typename ContextT, typename Lambda>
     int serve(ContextT& ctx, boost::beast::http::verb request_method, const std::string& subject, Lambda send){
-        std::string subject_decoded = udho::util::urldecode(subject);
+        int status = 0;
+        if(attempt(ctx, request_method, subject, send, status)){
+            return status;
+        }else{
+            return _parent.template serve<ContextT, Lambda>(ctx, request_method, subject, send);
+        }
+    }
+    /**
+     * serves the request using the mounted application only, if its path matches. Never bubbles the request to the parent.
+     */
+    template <typename ContextT, typename Lambda>
+    bool attempt(ContextT& ctx, boost::beast::http::verb request_method, const std::string& subject, Lambda send, int& status){
+        return attempt(ctx, request_method, subject, udho::util::urldecode(subject), send, status);
+    }
+    template <typename ContextT, typename Lambda>
+    bool attempt(ContextT& ctx, boost::beast::http::verb request_method, const std::string& subject, const std::string& subject_decoded, Lambda send, int& status){
         boost::smatch match;
-#ifdef WITH_ICU
-        bool result = boost::u32regex_search(subject_decoded, match, boost::make_u32regex(_overload._path));
-#else
-        bool result = boost::regex_search(subject_decoded, match, boost::regex(_overload._path));
-#endif
+        bool result = internal::search_pattern(subject_decoded, match, _overload._regex);
         if(result){
             std::string rest = result ? subject.substr(match.length()) : subject;
-            return _overload.serve(ctx, request_method, rest, send);
-        }else{
-            return _parent.template serve<ContextT, Lambda>(ctx, request_method, subject, send);
+            status = _overload.serve(ctx, request_method, rest, send);
         }
+        return result;
+    }
+    template <typename ContextT, typename Lambda, typename MatchT>
+    int invoke(ContextT& ctx, boost::beast::http::verb request_method, const std::string& subject, const MatchT& /*match*/, Lambda send){
+        int status = 0;
+        attempt(ctx, request_method, subject, send, status);
+        return status;
+    }
+    /**
+     * @return false as the overload is a mounted application
+     */
+    bool describe(module_info& info) const{
+        info._pattern = _overload._path;
+        info._fptr = &_overload._app;
+        info._compositor = "APPLICATION";
+        info._method = boost::beast::http::verb::unknown;
+        return false;
     }
     
     void summary(std::vector<module_info>& stack) const{
@@ -234,8 +277,26 @@ struct overload_group<U, app_<V, Ref>>{
     }
     template <typename AttachmentT>
     self_type& listen(boost::asio::io_service& io, AttachmentT& attachment, int port=9198){
-        typedef udho::listener<self_type, AttachmentT> listener_type;
-        std::make_shared<listener_type>(*this, io, attachment, boost::asio::ip::tcp::endpoint(boost::asio::ip::make_address("0.0.0.0"), port))->run();
+        return listen(io, attachment, udho::endpoint::tcp4(port));
+    }
+    /**
+     * listens on an IPv4 or IPv6 endpoint or a unix domain socket
+     */
+    template <typename AttachmentT>
+    self_type& listen(boost::asio::io_service& io, AttachmentT& attachment, const udho::endpoint& endpoint){
+        udho::listen(*this, io, attachment, endpoint);
+        return *this;
+    }
+    /**
+     * listens on every io_context of the pool with one SO_REUSEPORT acceptor per io_context
+     */
+    template <typename AttachmentT>
+    self_type& listen(udho::io_pool& pool, AttachmentT& attachment, int port=9198){
+        return listen(pool, attachment, udho::endpoint::tcp4(port));
+    }
+    template <typename AttachmentT>
+    self_type& listen(udho::io_pool& pool, AttachmentT& attachment, const udho::endpoint& endpoint){
+        udho::listen(*this, pool, attachment, endpoint);
         return *this;
     }
     template <typename F>
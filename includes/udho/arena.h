@@ -0,0 +1,179 @@
+/*
+ * Copyright (c) 2020, Neel Basu <neel.basu.z@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <organization> nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Neel Basu <neel.basu.z@gmail.com> ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Neel Basu <neel.basu.z@gmail.com> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef UDHO_ARENA_H
+#define UDHO_ARENA_H
+
+#include <new>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace udho{
+
+/**
+ * monotonic arena of a connection, from which the fields of its requests and the responses it composes itself are allocated.
+ * Memory is handed out by bumping an offset in a chain of blocks and is never given back one allocation at a time.
+ * Once every allocation has been released, e.g. between two keep-alive requests, reset() rewinds to the first block and the blocks are reused.
+ * Allocating and resetting must happen on one thread (the strand of the connection), whereas releasing is safe from any thread.
+ * \ingroup server
+ */
+class arena{
+    struct block{
+        char*       _data;
+        std::size_t _size;
+    };
+    
+    std::vector<block>       _blocks;
+    std::size_t              _block_size;
+    std::size_t              _current;  ///< block being allocated from
+    std::size_t              _offset;   ///< bytes used in the current block
+    std::atomic<std::size_t> _live;     ///< allocations not released yet
+  public:
+    /**
+     * @param block_size size of the blocks, an allocation larger than that gets a block of its own
+     */
+    explicit arena(std::size_t block_size = 4096): _block_size(block_size), _current(0), _offset(0), _live(0){}
+    arena(const arena&) = delete;
+    arena& operator=(const arena&) = delete;
+    ~arena(){
+        for(const block& b: _blocks){
+            ::operator delete(b._data);
+        }
+    }
+    void* allocate(std::size_t bytes, std::size_t alignment){
+        while(true){
+            if(_current == _blocks.size()){
+                std::size_t size = std::max(_block_size, bytes + alignment);
+                _blocks.push_back(block{static_cast<char*>(::operator new(size)), size});
+                _offset = 0;
+            }
+            block& b = _blocks[_current];
+            std::uintptr_t address = reinterpret_cast<std::uintptr_t>(b._data) + _offset;
+            std::size_t padding = (alignment - address % alignment) % alignment;
+            if(_offset + padding + bytes <= b._size){
+                _offset += padding + bytes;
+                _live.fetch_add(1, std::memory_order_relaxed);
+                return b._data + (_offset - bytes);
+            }
+            ++_current;
+            _offset = 0;
+        }
+    }
+    void deallocate(void* /*p*/, std::size_t /*bytes*/){
+        _live.fetch_sub(1, std::memory_order_release);
+    }
+    /**
+     * rewinds to the first block unless some allocation is still in use
+     * @return whether the arena has been rewound
+     */
+    bool reset(){
+        if(_live.load(std::memory_order_acquire) != 0){
+            return false;
+        }
+        _current = 0;
+        _offset  = 0;
+        return true;
+    }
+    /**
+     * allocations not released yet
+     */
+    std::size_t live() const{
+        return _live.load(std::memory_order_relaxed);
+    }
+    /**
+     * bytes held in the blocks
+     */
+    std::size_t capacity() const{
+        std::size_t total = 0;
+        for(const block& b: _blocks){
+            total += b._size;
+        }
+        return total;
+    }
+};
+
+/**
+ * allocator drawing from a udho::arena, or from the global heap if it has none, as when default constructed.
+ * The arena is shared so that memory released after the connection has gone is still returned to a live arena.
+ * A copied container allocates from the global heap, because the copy may outlive the connection or be used on another thread.
+ * \ingroup server
+ */
+template <typename T>
+struct arena_allocator{
+    typedef T value_type;
+    typedef std::true_type  propagate_on_container_move_assignment;
+    typedef std::true_type  propagate_on_container_swap;
+    typedef std::false_type propagate_on_container_copy_assignment;
+    typedef std::false_type is_always_equal;
+    
+    template <typename U>
+    struct rebind{
+        typedef arena_allocator<U> other;
+    };
+    
+    std::shared_ptr<udho::arena> _arena;
+    
+    arena_allocator() noexcept{}
+    explicit arena_allocator(std::shared_ptr<udho::arena> a) noexcept: _arena(std::move(a)){}
+    template <typename U>
+    arena_allocator(const arena_allocator<U>& other) noexcept: _arena(other._arena){}
+    
+    T* allocate(std::size_t n){
+        if(!_arena){
+            return std::allocator<T>().allocate(n);
+        }
+        return static_cast<T*>(_arena->allocate(n * sizeof(T), alignof(T)));
+    }
+    void deallocate(T* p, std::size_t n){
+        if(!_arena){
+            return std::allocator<T>().deallocate(p, n);
+        }
+        _arena->deallocate(p, n * sizeof(T));
+    }
+    arena_allocator select_on_container_copy_construction() const{
+        return arena_allocator();
+    }
+};
+
+template <typename T, typename U>
+bool operator==(const arena_allocator<T>& left, const arena_allocator<U>& right){
+    return left._arena == right._arena;
+}
+template <typename T, typename U>
+bool operator!=(const arena_allocator<T>& left, const arena_allocator<U>& right){
+    return !(left == right);
+}
+
+}
+
+#endif // UDHO_ARENA_H
@@ -0,0 +1,405 @@
+/*
+ * Copyright (c) 2020, Neel Basu <neel.basu.z@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <organization> nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Neel Basu <neel.basu.z@gmail.com> ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Neel Basu <neel.basu.z@gmail.com> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef UDHO_ASSETS_H
+#define UDHO_ASSETS_H
+
+#include <list>
+#include <mutex>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <fstream>
+#include <unordered_map>
+#include <boost/optional.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/asio/buffer.hpp>
+#include <boost/beast/http/message.hpp>
+#include <boost/algorithm/string/trim.hpp>
+#include <udho/configuration.h>
+#include <udho/util.h>
+
+namespace udho{
+
+/**
+ * body of a response that refers to an immutable string shared with a cache instead of copying it
+ * \ingroup server
+ */
+struct shared_body{
+    typedef std::shared_ptr<const std::string> value_type;
+
+    static std::uint64_t size(const value_type& body){
+        return body ? body->size() : 0;
+    }
+
+    class writer{
+        const value_type& _body;
+      public:
+        typedef boost::asio::const_buffer const_buffers_type;
+
+        template <bool isRequest, class Fields>
+        explicit writer(const boost::beast::http::header<isRequest, Fields>& /*header*/, const value_type& body): _body(body){}
+        void init(boost::beast::error_code& ec){
+            ec = {};
+        }
+        boost::optional<std::pair<const_buffers_type, bool>> get(boost::beast::error_code& ec){
+            ec = {};
+            if(!_body || _body->empty()){
+                return boost::none;
+            }
+            return {{const_buffers_type(_body->data(), _body->size()), false}};
+        }
+    };
+};
+
+/**
+ * a static file held in memory along with its validators
+ * \ingroup server
+ */
+struct asset{
+    std::shared_ptr<const std::string> _content;
+    std::uint64_t                      _size;
+    std::time_t                        _mtime;
+    std::string                        _etag;          ///< strong entity tag derived from the contents
+    std::string                        _last_modified; ///< mtime formatted as an HTTP date
+    std::string                        _mime;
+
+    /**
+     * whether the conditional headers of the request are satisfied by this asset so that 304 Not Modified can be sent.
+     * If-None-Match takes precedence over If-Modified-Since.
+     */
+    template <typename RequestT>
+    bool not_modified(const RequestT& req) const{
+        auto if_none_match = req[boost::beast::http::field::if_none_match];
+        if(!if_none_match.empty()){
+            return matches(if_none_match.to_string());
+        }
+        auto if_modified_since = req[boost::beast::http::field::if_modified_since];
+        std::time_t since;
+        if(!if_modified_since.empty() && internal::parse_http_date(if_modified_since.to_string(), since)){
+            return _mtime <= since;
+        }
+        return false;
+    }
+    /**
+     * weak comparison of the entity tag with a comma separated list of entity tags as used by If-None-Match
+     */
+    bool matches(const std::string& tags) const{
+        std::stringstream stream(tags);
+        std::string tag;
+        while(std::getline(stream, tag, ',')){
+            boost::algorithm::trim(tag);
+            if(tag == "*"){
+                return true;
+            }
+            if(tag.compare(0, 2, "W/") == 0){
+                tag = tag.substr(2);
+            }
+            if(tag == _etag){
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+/**
+ * LRU cache of static files keyed by the resolved local path, bounded by a memory budget.
+ * An entry is revalidated against the mtime and size of the file at most once per configured interval,
+ * so that repeated hits on the same asset do not touch the disk. Files larger than the configured limit
+ * are not cached and should be sent from disk instead.
+ * The cache is safe to use from all threads of an io_pool.
+ * \ingroup server
+ */
+class asset_cache{
+    typedef std::shared_ptr<const asset>          asset_ptr;
+    typedef std::list<std::string>                recency_type;
+    typedef std::chrono::steady_clock             clock_type;
+
+    struct entry{
+        asset_ptr                _asset;
+        recency_type::iterator   _position;
+        clock_type::time_point   _validated;
+    };
+
+    mutable std::mutex                       _mutex;
+    recency_type                             _recent;
+    std::unordered_map<std::string, entry>   _entries;
+    std::size_t                              _size;
+  public:
+    asset_cache(): _size(0){}
+    asset_cache(const asset_cache&) = delete;
+    asset_cache& operator=(const asset_cache&) = delete;
+    /**
+     * returns the cached asset for the local path, loading or reloading it from disk if required.
+     *
+     * @param local_path resolved path of the file inside the document root
+     * @param mime mime type of the file
+     * @param options budget, size limit and revalidation interval
+     * @return nullptr if the file does not exist, is not a regular file or is too large to be cached
+     */
+    asset_ptr fetch(const boost::filesystem::path& local_path, const std::string& mime, const udho::configs::assets& options){
+        const std::string key = local_path.string();
+        const clock_type::time_point now = clock_type::now();
+        asset_ptr cached;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            auto it = _entries.find(key);
+            if(it != _entries.end()){
+                _recent.splice(_recent.begin(), _recent, it->second._position);
+                cached = it->second._asset;
+                if(now - it->second._validated < options.get(udho::configs::assets::revalidate)){
+                    return cached;
+                }
+            }
+        }
+        boost::system::error_code ec;
+        if(!boost::filesystem::is_regular_file(local_path, ec)){
+            erase(key);
+            return nullptr;
+        }
+        std::uint64_t size  = boost::filesystem::file_size(local_path, ec);
+        std::time_t   mtime = boost::filesystem::last_write_time(local_path, ec);
+        if(ec || size > options.get(udho::configs::assets::file_limit)){
+            erase(key);
+            return nullptr;
+        }
+        if(cached && cached->_size == size && cached->_mtime == mtime){
+            std::lock_guard<std::mutex> lock(_mutex);
+            auto it = _entries.find(key);
+            if(it != _entries.end() && it->second._asset == cached){
+                it->second._validated = now;
+            }
+            return cached;
+        }
+        asset_ptr loaded = load(local_path, size, mtime, mime);
+        if(!loaded){
+            erase(key);
+            return nullptr;
+        }
+        insert(key, loaded, now, options.get(udho::configs::assets::budget));
+        return loaded;
+    }
+    /**
+     * number of bytes of file contents held in memory
+     */
+    std::size_t size() const{
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _size;
+    }
+    /**
+     * number of files held in memory
+     */
+    std::size_t count() const{
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _entries.size();
+    }
+    void clear(){
+        std::lock_guard<std::mutex> lock(_mutex);
+        _entries.clear();
+        _recent.clear();
+        _size = 0;
+    }
+  private:
+    static asset_ptr load(const boost::filesystem::path& local_path, std::uint64_t size, std::time_t mtime, const std::string& mime){
+        std::ifstream stream(local_path.c_str(), std::ios::binary);
+        if(!stream){
+            return nullptr;
+        }
+        std::shared_ptr<std::string> content = std::make_shared<std::string>(static_cast<std::size_t>(size), '\0');
+        if(size > 0 && !stream.read(&(*content)[0], static_cast<std::streamsize>(size))){
+            return nullptr;
+        }
+        // FNV-1a over the contents, so that the entity tag is strong and survives restarts
+        std::uint64_t hash = 14695981039346656037ULL;
+        for(unsigned char c: *content){
+            hash = (hash ^ c) * 1099511628211ULL;
+        }
+        std::shared_ptr<asset> a = std::make_shared<asset>();
+        a->_content       = content;
+        a->_size          = size;
+        a->_mtime         = mtime;
+        a->_etag          = (boost::format("\"%x-%x\"") % hash % size).str();
+        a->_last_modified = internal::http_date(mtime);
+        a->_mime          = mime;
+        return a;
+    }
+    void insert(const std::string& key, asset_ptr loaded, clock_type::time_point now, std::size_t budget){
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto it = _entries.find(key);
+        if(it != _entries.end()){
+            _size -= it->second._asset->_size;
+            _recent.erase(it->second._position);
+            _entries.erase(it);
+        }
+        if(loaded->_size > budget){
+            return;
+        }
+        _recent.push_front(key);
+        _entries[key] = entry{loaded, _recent.begin(), now};
+        _size += loaded->_size;
+        while(_size > budget && !_recent.empty()){
+            auto victim = _entries.find(_recent.back());
+            _size -= victim->second._asset->_size;
+            _entries.erase(victim);
+            _recent.pop_back();
+        }
+    }
+    void erase(const std::string& key){
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto it = _entries.find(key);
+        if(it != _entries.end()){
+            _size -= it->second._asset->_size;
+            _recent.erase(it->second._position);
+            _entries.erase(it);
+        }
+    }
+};
+
+/**
+ * bounded LRU cache of the static file lookups of the server, so that serving a static file does not canonicalize the
+ * document root or stat the file on every request. The canonical document root is computed once per change of the
+ * configured document root. Whether a local path is a regular file, including the negative answer, is remembered and
+ * checked again at most once per configured revalidation interval, so a flood of requests for missing assets is
+ * answered from memory. The cache is safe to use from all threads of an io_pool.
+ * \ingroup server
+ */
+class path_cache{
+    typedef std::list<std::string>                recency_type;
+    typedef std::chrono::steady_clock             clock_type;
+
+    struct entry{
+        bool                     _regular;
+        recency_type::iterator   _position;
+        clock_type::time_point   _validated;
+    };
+
+    mutable std::mutex                       _mutex;
+    boost::filesystem::path                  _configured;
+    boost::filesystem::path                  _canonical;
+    recency_type                             _recent;
+    std::unordered_map<std::string, entry>   _entries;
+  public:
+    path_cache() = default;
+    path_cache(const path_cache&) = delete;
+    path_cache& operator=(const path_cache&) = delete;
+    /**
+     * canonical form of the document root, recomputed only if the document root differs from the last one seen.
+     * Falls back to the document root itself if it cannot be canonicalized e.g. if it does not exist.
+     */
+    boost::filesystem::path root(const boost::filesystem::path& docroot){
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if(!_configured.empty() && _configured == docroot){
+                return _canonical;
+            }
+        }
+        boost::system::error_code ec;
+        boost::filesystem::path canonical = boost::filesystem::canonical(docroot, ec);
+        if(ec){
+            canonical = docroot;
+        }
+        std::lock_guard<std::mutex> lock(_mutex);
+        if(_configured != docroot){
+            _entries.clear();
+            _recent.clear();
+        }
+        _configured = docroot;
+        _canonical  = canonical;
+        return _canonical;
+    }
+    /**
+     * local path of a request path inside the document root
+     * @return false if the request path escapes the document root
+     */
+    bool locate(const boost::filesystem::path& docroot, const std::string& path, boost::filesystem::path& local_path){
+        boost::filesystem::path base = root(docroot);
+        local_path = internal::path_cat(base, path);
+        if(!internal::path_inside(base, local_path)){
+            return false;
+        }
+        local_path = local_path.lexically_normal();
+        return true;
+    }
+    /**
+     * whether the local path is a regular file, answered from the cache if it has been checked within the revalidation interval
+     */
+    bool exists(const boost::filesystem::path& local_path, const udho::configs::assets& options){
+        const std::size_t capacity = options.get(udho::configs::assets::paths);
+        const std::string key = local_path.string();
+        const clock_type::time_point now = clock_type::now();
+        if(capacity > 0){
+            std::lock_guard<std::mutex> lock(_mutex);
+            auto it = _entries.find(key);
+            if(it != _entries.end() && now - it->second._validated < options.get(udho::configs::assets::revalidate)){
+                _recent.splice(_recent.begin(), _recent, it->second._position);
+                return it->second._regular;
+            }
+        }
+        boost::system::error_code ec;
+        bool regular = boost::filesystem::is_regular_file(local_path, ec);
+        if(capacity > 0){
+            std::lock_guard<std::mutex> lock(_mutex);
+            auto it = _entries.find(key);
+            if(it != _entries.end()){
+                _recent.splice(_recent.begin(), _recent, it->second._position);
+                it->second._regular   = regular;
+                it->second._validated = now;
+            }else{
+                _recent.push_front(key);
+                _entries[key] = entry{regular, _recent.begin(), now};
+                while(_entries.size() > capacity){
+                    _entries.erase(_recent.back());
+                    _recent.pop_back();
+                }
+            }
+        }
+        return regular;
+    }
+    /**
+     * forgets the lookup of a local path e.g. after the file turned out to be missing while opening it
+     */
+    void forget(const boost::filesystem::path& local_path){
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto it = _entries.find(local_path.string());
+        if(it != _entries.end()){
+            _recent.erase(it->second._position);
+            _entries.erase(it);
+        }
+    }
+    /**
+     * number of lookups held in memory
+     */
+    std::size_t count() const{
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _entries.size();
+    }
+};
+
+}
+
+#endif // UDHO_ASSETS_H
@@ -29,10 +29,13 @@
 #define UDHO_BRIDGE_H
 
 #include <string>
+#include <memory>
+#include <chrono>
 #include <boost/filesystem.hpp>
 #include <boost/beast/http/message.hpp>
 #include <boost/beast/http/file_body.hpp>
 #include <udho/defs.h>
+#include <udho/headers.h>
 #include <udho/access.h>
 #include <udho/scope.h>
 #include <udho/parser.h>
@@ -42,6 +45,13 @@
 #include <udho/configuration.h>
 #include <udho/client.h>
 #include <udho/url.h>
+#include <udho/assets.h>
+#include <udho/compression.h>
+#include <udho/ranges.h>
+#include <udho/metrics.h>
+#include <udho/workers.h>
+#include <udho/registry.h>
+#include <udho/admission.h>
 
 namespace udho{
     
@@ -56,8 +66,14 @@ struct bridge{
     
     boost::asio::io_service& _io;
     configuration_type _config; 
+    std::shared_ptr<udho::asset_cache> _assets;
+    std::shared_ptr<udho::path_cache> _paths;
+    std::shared_ptr<udho::metrics> _metrics;
+    std::shared_ptr<udho::workers> _workers;
+    std::shared_ptr<udho::registry> _connections;
+    std::shared_ptr<udho::admission> _admission;
 
-    bridge(boost::asio::io_service& io): _io(io){}
+    bridge(boost::asio::io_service& io): _io(io), _assets(std::make_shared<udho::asset_cache>()), _paths(std::make_shared<udho::path_cache>()), _metrics(std::make_shared<udho::metrics>()), _workers(std::make_shared<udho::workers>()), _connections(std::make_shared<udho::registry>()), _admission(std::make_shared<udho::admission>()){}
     
     configuration_type& config(){
         return _config;
@@ -68,6 +84,68 @@ struct bridge{
     boost::filesystem::path docroot() const{
         return _config[udho::configs::server::document_root];
     }
+    /**
+     * in memory cache of static files, used when `udho::configs::assets::cache` is enabled
+     */
+    udho::asset_cache& assets() const{
+        return *_assets;
+    }
+    /**
+     * canonical document root and the static file lookups inside it
+     */
+    udho::path_cache& paths() const{
+        return *_paths;
+    }
+    /**
+     * counters of the events of the server e.g. timeouts
+     */
+    udho::metrics& metrics() const{
+        return *_metrics;
+    }
+    /**
+     * worker threads running the blocking handlers, with their queue depth and wait times
+     */
+    udho::workers& workers() const{
+        return *_workers;
+    }
+    /**
+     * runs the task on the worker threads unless `udho::configs::workers::limit` tasks are already queued or running
+     * @return false if the task has been rejected
+     */
+    bool blocking(std::function<void ()> task) const{
+        return workers().submit(task, _config[udho::configs::workers::threads], _config[udho::configs::workers::limit]);
+    }
+    /**
+     * live connections and listeners, drained on SIGINT or SIGTERM
+     */
+    udho::registry& connections() const{
+        return *_connections;
+    }
+    /**
+     * requests in flight and the CoDel state of the load shedding
+     */
+    udho::admission& admission() const{
+        return *_admission;
+    }
+    /**
+     * whether a request that waited sojourn before being dispatched is served, always true unless `udho::configs::admission::target` is set
+     */
+    bool admit(std::chrono::steady_clock::duration sojourn) const{
+        std::chrono::milliseconds target = _config[udho::configs::admission::target];
+        if(target.count() == 0){
+            return true;
+        }
+        return admission().admit(sojourn, target, _config[udho::configs::admission::interval]);
+    }
+    /**
+     * 503 Service Unavailable with Retry-After for a request shed because the server is overloaded
+     */
+    udho::exceptions::http_error shed(const std::string& reason) const{
+        metrics().increment(udho::metrics::shed_requests);
+        udho::exceptions::http_error error(boost::beast::http::status::service_unavailable, reason);
+        error.add_header(boost::beast::http::field::retry_after, std::to_string(_config[udho::configs::admission::retry_after].count()));
+        return error;
+    }
     boost::filesystem::path tmplroot() const{
         return _config[udho::configs::server::template_root];
     }
@@ -76,22 +154,19 @@ struct bridge{
         std::string content((std::istreambuf_iterator<char>(ifs)), (std::istreambuf_iterator<char>()));
         return content;
     }
+    /**
+     * the whole file inside the document root as a response, negotiating a precompressed sibling if enabled
+     * @see ranged for Range requests
+     */
     boost::beast::http::response<boost::beast::http::file_body> file(const std::string& path, const ::udho::defs::request_type& req, std::string mime = "") const{
-        boost::filesystem::path doc_root = docroot();
-        boost::filesystem::path local_path = internal::path_cat(doc_root, path);
-        if(!internal::path_inside(doc_root, local_path)){
-            throw exceptions::http_error(boost::beast::http::status::forbidden, (boost::format("Access denied to %1%") % local_path).str());
-        }
-        std::string extension = local_path.extension().string();
-        std::string mime_type = _config[udho::configs::server::mime_default];
-        if(!extension.empty() && extension.front() == '.'){
-            extension = extension.substr(1);
-            mime_type = _config[udho::configs::server::mimes].at(extension);
-        }
+        boost::filesystem::path local_path;
+        std::string content_encoding;
+        std::string mime_type = resolve(path, req, local_path, content_encoding);
         boost::beast::error_code err;
         boost::beast::http::file_body::value_type body;
         body.open(local_path.c_str(), boost::beast::file_mode::scan, err);
         if(err == boost::system::errc::no_such_file_or_directory){
+            paths().forget(local_path);
             throw udho::exceptions::http_error(boost::beast::http::status::not_found, (boost::format("File `%1%` not found in disk") % local_path).str());
         }
         if(err){
@@ -99,12 +174,45 @@ struct bridge{
         }
         auto const size = body.size();
         boost::beast::http::response<boost::beast::http::file_body> res{std::piecewise_construct, std::make_tuple(std::move(body)), std::make_tuple(boost::beast::http::status::ok, req.version())};
-        res.set(boost::beast::http::field::server, BOOST_BEAST_VERSION_STRING);
-        res.set(boost::beast::http::field::content_type, !mime.empty() ? mime : mime_type);
+        udho::headers::stamp(res, !mime.empty() ? mime : mime_type);
+        if(negotiable()){
+            udho::compression::negotiated(res, content_encoding);
+        }
         res.content_length(size);
         res.keep_alive(req.keep_alive());
         return res;
     }
+    /**
+     * a file inside the document root as a response that honors the Range and If-Range headers of the request.
+     * Responds with 206 Partial Content for satisfiable ranges (multipart/byteranges for more than one range)
+     * and 416 Range Not Satisfiable otherwise. Only the requested ranges are read from the disk.
+     */
+    boost::beast::http::response<udho::ranged_file_body> ranged(const std::string& path, const ::udho::defs::request_type& req, std::string mime = "") const{
+        boost::filesystem::path local_path;
+        std::string content_encoding;
+        std::string mime_type = resolve(path, req, local_path, content_encoding);
+        if(!mime.empty()){
+            mime_type = mime;
+        }
+        boost::beast::error_code err;
+        boost::beast::http::response<udho::ranged_file_body> res{boost::beast::http::status::ok, req.version()};
+        res.body().open(local_path.c_str(), err);
+        if(err == boost::system::errc::no_such_file_or_directory){
+            paths().forget(local_path);
+            throw udho::exceptions::http_error(boost::beast::http::status::not_found, (boost::format("File `%1%` not found in disk") % local_path).str());
+        }
+        if(err){
+            throw udho::exceptions::http_error(boost::beast::http::status::internal_server_error, (boost::format("Error %1% while reading file `%2%` from disk") % err % local_path).str());
+        }
+        udho::headers::stamp(res, mime_type);
+        internal::file_validators(res, local_path);
+        if(negotiable()){
+            udho::compression::negotiated(res, content_encoding);
+        }
+        res.keep_alive(req.keep_alive());
+        udho::select_ranges(res, req, mime_type);
+        return res;
+    }
     
     template <typename RequestT, typename GroupT>
     std::string render(const std::string& path, const udho::detail::context_common<self_type, RequestT>& ctx, ::udho::lookup_table<GroupT>& scope) const{
@@ -138,6 +246,42 @@ struct bridge{
     detail::client_connection_wrapper<ContextT> client(ContextT ctx, udho::config<udho::client_options> options){
         return detail::client_connection_wrapper<ContextT>(_io, ctx, options);
     }
+  private:
+    bool negotiable() const{
+        const udho::configs::assets& assets_options = _config;
+        return assets_options.get(udho::configs::assets::precompressed);
+    }
+    /**
+     * resolves the path against the document root, looking for an acceptable precompressed sibling if enabled.
+     * Throws 403 if the path escapes the document root and 404 if the file is known to be missing.
+     * @return the mime type of the file
+     */
+    std::string resolve(const std::string& path, const ::udho::defs::request_type& req, boost::filesystem::path& local_path, std::string& content_encoding) const{
+        if(!paths().locate(docroot(), path, local_path)){
+            throw exceptions::http_error(boost::beast::http::status::forbidden, (boost::format("Access denied to %1%") % local_path).str());
+        }
+        const udho::configs::assets& assets_options = _config;
+        if(!paths().exists(local_path, assets_options)){
+            throw udho::exceptions::http_error(boost::beast::http::status::not_found, (boost::format("File `%1%` not found in disk") % local_path).str());
+        }
+        std::string extension = local_path.extension().string();
+        std::string mime_type = _config[udho::configs::server::mime_default];
+        if(!extension.empty() && extension.front() == '.'){
+            extension = extension.substr(1);
+            const udho::configs::server& server_config = _config;
+            const auto& mimes = server_config.get(udho::configs::server::mimes);
+            auto it = mimes.find(extension);
+            if(it != mimes.end()){
+                mime_type = it->second;
+            }
+        }
+        if(negotiable()){
+            content_encoding = udho::compression::precompressed(local_path, req[boost::beast::http::field::accept_encoding].to_string(), [&](const boost::filesystem::path& sibling){
+                return paths().exists(sibling, assets_options);
+            });
+        }
+        return mime_type;
+    }
 };
 
 }
@@ -31,6 +31,8 @@
 #include <string>
 #include <boost/beast/http/message.hpp>
 #include <boost/format.hpp>
+#include <udho/compression.h>
+#include <udho/headers.h>
 
 namespace udho{
     
@@ -85,8 +87,7 @@ namespace compositors{
         response_type operator()(const ContextT& ctx, const OutputT& out){
             std::string content = boost::lexical_cast<std::string>(out);
             response_type res{boost::beast::http::status::ok, ctx.request().version()};
-            res.set(boost::beast::http::field::server, UDHO_VERSION_STRING);
-            res.set(boost::beast::http::field::content_type,   _mime);
+            udho::headers::stamp(res, _mime);
 #if BOOST_VERSION >= 107400
             res.content_length(content.size());
 #else
@@ -101,6 +102,65 @@ namespace compositors{
             return (boost::format("MIMED %1%") % _mime).str();
         }
     };
+    /**
+     * \ingroup routing.content
+     * mimed content compressed with the gzip or deflate coding negotiated from the Accept-Encoding of the request.
+     * Bodies smaller than the minimum size and content of already compressed mime types are sent uncompressed.
+     * Bodies larger than the streaming threshold are compressed while being written and sent chunked to HTTP/1.1 clients.
+     * Without zlib (WITH_ZLIB) the content is always sent uncompressed.
+     * \see udho::module_overload::compressed
+     */
+    template <typename OutputT>
+    struct compressed{
+        typedef boost::beast::http::response<udho::compression::encoded_body> response_type;
+        std::string _mime;
+        int         _level;
+        std::size_t _min_size;
+        std::size_t _streaming;
+        
+        /**
+         * @param mime returned mime type
+         * @param level compression level 0 - 9, -1 for zlib's default
+         * @param min_size bodies smaller than this are not compressed
+         * @param streaming bodies larger than this are compressed while being written, 0 to always compress in memory
+         */
+        compressed(const std::string& mime, int level = -1, std::size_t min_size = 1024, std::size_t streaming = 0): _mime(mime), _level(level), _min_size(min_size), _streaming(streaming){}
+        template <typename ContextT>
+        response_type operator()(const ContextT& ctx, const OutputT& out){
+            response_type res{boost::beast::http::status::ok, ctx.request().version()};
+            udho::headers::stamp(res, _mime);
+            res.keep_alive(ctx.request().keep_alive());
+            udho::compression::encoded_body::value_type& body = res.body();
+            body._content = boost::lexical_cast<std::string>(out);
+            body._level   = _level;
+            if(udho::compression::compressible_mime(_mime)){
+                res.set(boost::beast::http::field::vary, "Accept-Encoding");
+#ifdef WITH_ZLIB
+                std::string coding = body._content.size() < _min_size ? std::string() : udho::compression::negotiate(ctx.request()[boost::beast::http::field::accept_encoding].to_string());
+                if(!coding.empty() && _streaming && body._content.size() > _streaming && ctx.request().version() >= 11){
+                    body._coding    = coding;
+                    body._streaming = true;
+                    res.set(boost::beast::http::field::content_encoding, coding);
+                    res.chunked(true);
+                    return res;
+                }
+                if(!coding.empty()){
+                    std::string encoded = udho::compression::zlib(body._content, _level, coding == "gzip");
+                    if(encoded.size() < body._content.size()){
+                        body._content = std::move(encoded);
+                        body._coding  = coding;
+                        res.set(boost::beast::http::field::content_encoding, coding);
+                    }
+                }
+#endif
+            }
+            res.prepare_payload();
+            return res;
+        }
+        std::string name() const{
+            return (boost::format("COMPRESSED %1%") % _mime).str();
+        }
+    };
 }
     
 }
@@ -0,0 +1,410 @@
+/*
+ * Copyright (c) 2020, Neel Basu <neel.basu.z@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <organization> nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Neel Basu <neel.basu.z@gmail.com> ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Neel Basu <neel.basu.z@gmail.com> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef UDHO_COMPRESSION_H
+#define UDHO_COMPRESSION_H
+
+#include <set>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <iterator>
+#include <stdexcept>
+#include <boost/optional.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/asio/buffer.hpp>
+#include <boost/beast/core/error.hpp>
+#include <boost/beast/http/field.hpp>
+#include <boost/beast/http/message.hpp>
+#include <boost/algorithm/string/trim.hpp>
+#include <boost/algorithm/string/case_conv.hpp>
+
+#ifdef WITH_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef WITH_BROTLI
+#include <brotli/encode.h>
+#endif
+
+namespace udho{
+
+/**
+ * content codings used for static files and compressed responses
+ * \ingroup server
+ */
+namespace compression{
+
+    /**
+     * quality value of a content coding in an Accept-Encoding header.
+     * `identity` is acceptable unless explicitly refused, any other coding is acceptable only if listed or matched by `*`.
+     * @return the quality in [0, 1], 0 meaning not acceptable
+     */
+    inline double quality(const std::string& accept_encoding, const std::string& coding){
+        double wildcard = -1, listed = -1;
+        std::stringstream stream(accept_encoding);
+        std::string item;
+        while(std::getline(stream, item, ',')){
+            std::string name = item, parameters;
+            std::size_t semicolon = item.find(';');
+            if(semicolon != std::string::npos){
+                name = item.substr(0, semicolon);
+                parameters = item.substr(semicolon+1);
+            }
+            boost::algorithm::trim(name);
+            boost::algorithm::to_lower(name);
+            double q = 1.0;
+            boost::algorithm::trim(parameters);
+            if(parameters.compare(0, 2, "q=") == 0){
+                try{
+                    q = std::stod(parameters.substr(2));
+                }catch(...){
+                    q = 0;
+                }
+            }
+            if(name == coding){
+                listed = q;
+            }else if(name == "*"){
+                wildcard = q;
+            }
+        }
+        if(listed >= 0){
+            return listed;
+        }
+        if(wildcard >= 0){
+            return wildcard;
+        }
+        return coding == "identity" ? 1.0 : 0.0;
+    }
+    inline bool accepts(const std::string& accept_encoding, const std::string& coding){
+        return quality(accept_encoding, coding) > 0;
+    }
+
+    /**
+     * file name suffix of the precompressed sibling for a content coding
+     */
+    inline std::string suffix(const std::string& coding){
+        if(coding == "br")   return ".br";
+        if(coding == "gzip") return ".gz";
+        return "";
+    }
+
+    /**
+     * looks for a precompressed sibling (`.br` preferred over `.gz`) of a static file that is acceptable to the client.
+     * On success local_path is replaced with the path of the sibling.
+     *
+     * @param local_path resolved path of the requested file
+     * @param accept_encoding Accept-Encoding header of the request
+     * @param exists called as `exists(path)` to check whether a sibling is a regular file e.g. through udho::path_cache
+     * @return the content coding of the sibling, empty if the file itself has to be served
+     */
+    template <typename ExistsF>
+    std::string precompressed(boost::filesystem::path& local_path, const std::string& accept_encoding, ExistsF exists){
+        static const char* codings[] = {"br", "gzip"};
+        if(accept_encoding.empty()){
+            return "";
+        }
+        for(const char* coding: codings){
+            if(!accepts(accept_encoding, coding)){
+                continue;
+            }
+            boost::filesystem::path sibling = local_path;
+            sibling += suffix(coding);
+            if(exists(sibling)){
+                local_path = sibling;
+                return coding;
+            }
+        }
+        return "";
+    }
+    inline std::string precompressed(boost::filesystem::path& local_path, const std::string& accept_encoding){
+        return precompressed(local_path, accept_encoding, [](const boost::filesystem::path& sibling){
+            boost::system::error_code ec;
+            return boost::filesystem::is_regular_file(sibling, ec);
+        });
+    }
+
+    /**
+     * marks a response as one of the negotiated representations of a resource
+     * @param coding content coding of the body, empty for identity
+     */
+    template <typename MessageT>
+    void negotiated(MessageT& res, const std::string& coding){
+        if(!coding.empty()){
+            res.set(boost::beast::http::field::content_encoding, coding);
+        }
+        res.set(boost::beast::http::field::vary, "Accept-Encoding");
+    }
+
+    /**
+     * whether files with the extension are worth compressing. Images, archives and media are already compressed.
+     */
+    inline bool compressible(const boost::filesystem::path& path){
+        static const std::set<std::string> extensions = {
+            ".html", ".htm", ".xhtml", ".css", ".js", ".mjs", ".json", ".geojson", ".map", ".xml", ".svg", ".txt", ".csv", ".md", ".wasm", ".ttf", ".otf", ".eot", ".ico"
+        };
+        std::string extension = path.extension().string();
+        boost::algorithm::to_lower(extension);
+        return extensions.count(extension) > 0;
+    }
+
+    /**
+     * whether content of the mime type is worth compressing. Textual types are, images (except svg), media and archives are not.
+     */
+    inline bool compressible_mime(const std::string& mime){
+        static const char* textual[] = {"json", "xml", "javascript", "ecmascript", "wasm", "x-www-form-urlencoded"};
+        std::string type = mime.substr(0, mime.find(';'));
+        boost::algorithm::trim(type);
+        boost::algorithm::to_lower(type);
+        if(type.compare(0, 5, "text/") == 0){
+            return true;
+        }
+        for(const char* name: textual){
+            if(type.find(name) != std::string::npos){
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * the most preferred content coding among gzip and deflate that the client accepts, gzip winning a tie.
+     * @return the coding or empty if only identity is acceptable
+     */
+    inline std::string negotiate(const std::string& accept_encoding){
+        if(accept_encoding.empty()){
+            return "";
+        }
+        double gzip = quality(accept_encoding, "gzip"), deflate = quality(accept_encoding, "deflate");
+        if(gzip <= 0 && deflate <= 0){
+            return "";
+        }
+        return gzip >= deflate ? "gzip" : "deflate";
+    }
+
+#ifdef WITH_ZLIB
+    /**
+     * compresses the input with zlib
+     * @param level compression level 0 - 9, -1 for zlib's default
+     * @param gzip gzip framing if true, zlib (HTTP deflate) framing otherwise
+     */
+    inline std::string zlib(const std::string& input, int level = Z_DEFAULT_COMPRESSION, bool gzip = true){
+        z_stream stream = {};
+        if(deflateInit2(&stream, level, Z_DEFLATED, gzip ? 15 + 16 : 15, 8, Z_DEFAULT_STRATEGY) != Z_OK){
+            throw std::runtime_error("deflateInit2 failed");
+        }
+        std::string output(::deflateBound(&stream, static_cast<uLong>(input.size())), '\0');
+        stream.next_in   = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+        stream.avail_in  = static_cast<uInt>(input.size());
+        stream.next_out  = reinterpret_cast<Bytef*>(&output[0]);
+        stream.avail_out = static_cast<uInt>(output.size());
+        int result = ::deflate(&stream, Z_FINISH);
+        output.resize(stream.total_out);
+        ::deflateEnd(&stream);
+        if(result != Z_STREAM_END){
+            throw std::runtime_error("deflate failed");
+        }
+        return output;
+    }
+    inline std::string gzip(const std::string& input, int level = Z_DEFAULT_COMPRESSION){
+        return zlib(input, level, true);
+    }
+    inline std::string deflate(const std::string& input, int level = Z_DEFAULT_COMPRESSION){
+        return zlib(input, level, false);
+    }
+#endif
+
+    /**
+     * body of a response produced by compressing content.
+     * If `streaming` is false the content is sent as it is, i.e. it has already been encoded with the coding.
+     * Otherwise the uncompressed content is compressed with zlib while it is being written, one chunk at a time,
+     * so that the compressed form is never held in memory as a whole. A streaming body has no known size
+     * and has to be sent with chunked transfer encoding.
+     */
+    struct encoded_body{
+        struct value_type{
+            std::string _content;
+            std::string _coding;
+            int         _level;
+            bool        _streaming;
+
+            value_type(): _level(-1), _streaming(false){}
+        };
+
+        static std::uint64_t size(const value_type& body){
+            return body._content.size();
+        }
+
+        class writer{
+            enum { chunk = 64 * 1024 };
+
+            const value_type& _body;
+            bool              _finished;
+#ifdef WITH_ZLIB
+            z_stream          _stream;
+            bool              _initialized;
+            std::string       _buffer;
+#endif
+          public:
+            typedef boost::asio::const_buffer const_buffers_type;
+
+            template <bool isRequest, class Fields>
+            explicit writer(const boost::beast::http::header<isRequest, Fields>& /*header*/, const value_type& body): _body(body), _finished(false){
+#ifdef WITH_ZLIB
+                _stream = z_stream();
+                _initialized = false;
+#endif
+            }
+            writer(const writer&) = delete;
+            writer& operator=(const writer&) = delete;
+            ~writer(){
+#ifdef WITH_ZLIB
+                if(_initialized){
+                    ::deflateEnd(&_stream);
+                }
+#endif
+            }
+            void init(boost::beast::error_code& ec){
+                ec = {};
+#ifdef WITH_ZLIB
+                if(_body._streaming){
+                    if(deflateInit2(&_stream, _body._level, Z_DEFLATED, _body._coding == "gzip" ? 15 + 16 : 15, 8, Z_DEFAULT_STRATEGY) != Z_OK){
+                        ec = boost::beast::errc::make_error_code(boost::beast::errc::not_enough_memory);
+                        return;
+                    }
+                    _initialized      = true;
+                    _stream.next_in   = reinterpret_cast<Bytef*>(const_cast<char*>(_body._content.data()));
+                    _stream.avail_in  = static_cast<uInt>(_body._content.size());
+                    _buffer.resize(chunk);
+                }
+#endif
+            }
+            boost::optional<std::pair<const_buffers_type, bool>> get(boost::beast::error_code& ec){
+                ec = {};
+                if(_finished){
+                    return boost::none;
+                }
+#ifdef WITH_ZLIB
+                if(_initialized){
+                    _stream.next_out  = reinterpret_cast<Bytef*>(&_buffer[0]);
+                    _stream.avail_out = static_cast<uInt>(_buffer.size());
+                    int result = ::deflate(&_stream, Z_FINISH);
+                    if(result == Z_STREAM_END){
+                        _finished = true;
+                    }else if(result != Z_OK && result != Z_BUF_ERROR){
+                        ec = boost::beast::errc::make_error_code(boost::beast::errc::io_error);
+                        return boost::none;
+                    }
+                    std::size_t produced = _buffer.size() - _stream.avail_out;
+                    return {{const_buffers_type(_buffer.data(), produced), !_finished}};
+                }
+#endif
+                _finished = true;
+                if(_body._content.empty()){
+                    return boost::none;
+                }
+                return {{const_buffers_type(_body._content.data(), _body._content.size()), false}};
+            }
+        };
+    };
+
+#ifdef WITH_BROTLI
+    /**
+     * compresses the input with brotli
+     * @param quality 0 - 11
+     */
+    inline std::string brotli(const std::string& input, int quality = BROTLI_MAX_QUALITY){
+        std::size_t size = BrotliEncoderMaxCompressedSize(input.size());
+        std::string output(size ? size : input.size() + 1024, '\0');
+        size = output.size();
+        if(!BrotliEncoderCompress(quality, BROTLI_DEFAULT_WINDOW, BROTLI_MODE_GENERIC, input.size(), reinterpret_cast<const uint8_t*>(input.data()), &size, reinterpret_cast<uint8_t*>(&output[0]))){
+            throw std::runtime_error("BrotliEncoderCompress failed");
+        }
+        output.resize(size);
+        return output;
+    }
+#endif
+
+    /**
+     * creates the precompressed `.gz` (and `.br` if built with brotli) siblings of the compressible files of a directory tree.
+     * Siblings that are newer than their source are kept, and a sibling is not written if it is not smaller than the source.
+     * Can be run at startup on the document root or offline using the `udho-precompress` tool.
+     *
+     * @param root the document root
+     * @param min_size files smaller than this are not compressed
+     * @return number of siblings written
+     */
+    inline std::size_t precompress(const boost::filesystem::path& root, std::size_t min_size = 256){
+        std::vector<std::string> codings;
+#ifdef WITH_BROTLI
+        codings.push_back("br");
+#endif
+#ifdef WITH_ZLIB
+        codings.push_back("gzip");
+#endif
+        std::size_t written = 0;
+        boost::system::error_code ec;
+        for(boost::filesystem::recursive_directory_iterator it(root, ec), end; !ec && it != end; it.increment(ec)){
+            const boost::filesystem::path source = it->path();
+            if(!boost::filesystem::is_regular_file(source, ec) || !compressible(source) || boost::filesystem::file_size(source, ec) < min_size){
+                continue;
+            }
+            std::string content;
+            for(const std::string& coding: codings){
+                boost::filesystem::path sibling = source;
+                sibling += suffix(coding);
+                if(boost::filesystem::exists(sibling, ec) && boost::filesystem::last_write_time(sibling, ec) >= boost::filesystem::last_write_time(source, ec)){
+                    continue;
+                }
+                if(content.empty()){
+                    std::ifstream input(source.c_str(), std::ios::binary);
+                    content.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+                }
+                std::string compressed;
+#ifdef WITH_BROTLI
+                if(coding == "br")   compressed = brotli(content);
+#endif
+#ifdef WITH_ZLIB
+                if(coding == "gzip") compressed = gzip(content, Z_BEST_COMPRESSION);
+#endif
+                if(compressed.empty() || compressed.size() >= content.size()){
+                    continue;
+                }
+                std::ofstream output(sibling.c_str(), std::ios::binary | std::ios::trunc);
+                output.write(compressed.data(), static_cast<std::streamsize>(compressed.size()));
+                ++written;
+            }
+        }
+        return written;
+    }
+}
+
+}
+
+#endif // UDHO_COMPRESSION_H
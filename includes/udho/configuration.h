@@ -30,6 +30,7 @@
 
 #include <map>
 #include <string>
+#include <chrono>
 #include <boost/filesystem/path.hpp>
 
 #define UDHO_SESSION_FILE_EXTENSION "udho.cache.sess"
@@ -130,14 +131,18 @@ struct server_{
     const static struct mimes_t{
         typedef server_<T> component;
     } mimes;
+    const static struct pipeline_t{
+        typedef server_<T> component;
+    } pipeline;
     
     boost::filesystem::path _document_root;
     boost::filesystem::path _template_root;
     std::string _mime_default;
     mime_map    _mimes;
+    std::size_t _pipeline;
     
     
-    server_(): _mime_default("application/octet-stream"){
+    server_(): _mime_default("application/octet-stream"), _pipeline(16){
         _mimes.insert(std::make_pair("htm",     "text/html"));
         _mimes.insert(std::make_pair("html",    "text/html"));
         _mimes.insert(std::make_pair("xhtm",    "text/html"));
@@ -173,6 +178,12 @@ struct server_{
     std::string get(mime_default_t) const{return _mime_default;}
 
     const mime_map& get(mimes_t) const{return _mimes;}
+    
+    /**
+     * maximum number of pipelined requests of a connection that are read ahead of their responses being written
+     */
+    void set(pipeline_t, std::size_t v){_pipeline = v;}
+    std::size_t get(pipeline_t) const{return _pipeline;}
     std::string mime(const std::string& extension) const{
         return _mimes.at(extension);
     }
@@ -185,6 +196,7 @@ template <typename T> const typename server_<T>::document_root_t server_<T>::doc
 template <typename T> const typename server_<T>::template_root_t server_<T>::template_root;
 template <typename T> const typename server_<T>::mime_default_t  server_<T>::mime_default;
 template <typename T> const typename server_<T>::mimes_t         server_<T>::mimes;
+template <typename T> const typename server_<T>::pipeline_t      server_<T>::pipeline;
 
 /**
  * \ingroup configuration
@@ -350,10 +362,250 @@ struct form_{
 typedef form_<> form;
 }
 
+namespace configs{
+/**
+ * options of the in memory cache of static files served from the document root
+ * @code
+ * server[udho::configs::assets::cache]      = true;
+ * server[udho::configs::assets::budget]     = 64 * 1024 * 1024;   // bytes of file contents kept in memory
+ * server[udho::configs::assets::file_limit] = 1024 * 1024;        // larger files are always sent from disk
+ * server[udho::configs::assets::revalidate] = std::chrono::milliseconds(1000);
+ * server[udho::configs::assets::precompressed] = true;            // serve foo.js.br / foo.js.gz siblings if acceptable
+ * server[udho::configs::assets::paths]      = 4096;               // static file lookups remembered, 0 to stat every request
+ * @endcode
+ * \ingroup configuration
+ */
+template <typename T = void>
+struct assets_{
+    const static struct cache_t{
+        typedef assets_<T> component;
+    } cache;
+    const static struct budget_t{
+        typedef assets_<T> component;
+    } budget;
+    const static struct file_limit_t{
+        typedef assets_<T> component;
+    } file_limit;
+    const static struct revalidate_t{
+        typedef assets_<T> component;
+    } revalidate;
+    const static struct precompressed_t{
+        typedef assets_<T> component;
+    } precompressed;
+    const static struct paths_t{
+        typedef assets_<T> component;
+    } paths;
+    
+    bool                      _cache;
+    std::size_t               _budget;
+    std::size_t               _file_limit;
+    std::chrono::milliseconds _revalidate;
+    bool                      _precompressed;
+    std::size_t               _paths;
+    
+    assets_(): _cache(false), _budget(64 * 1024 * 1024), _file_limit(1024 * 1024), _revalidate(1000), _precompressed(false), _paths(4096){}
+    
+    void set(cache_t, bool v){_cache = v;}
+    bool get(cache_t) const{return _cache;}
+    
+    void set(budget_t, std::size_t v){_budget = v;}
+    std::size_t get(budget_t) const{return _budget;}
+    
+    void set(file_limit_t, std::size_t v){_file_limit = v;}
+    std::size_t get(file_limit_t) const{return _file_limit;}
+    
+    void set(revalidate_t, std::chrono::milliseconds v){_revalidate = v;}
+    std::chrono::milliseconds get(revalidate_t) const{return _revalidate;}
+    
+    void set(precompressed_t, bool v){_precompressed = v;}
+    bool get(precompressed_t) const{return _precompressed;}
+    
+    void set(paths_t, std::size_t v){_paths = v;}
+    std::size_t get(paths_t) const{return _paths;}
+};
+
+template <typename T> const typename assets_<T>::cache_t      assets_<T>::cache;
+template <typename T> const typename assets_<T>::budget_t     assets_<T>::budget;
+template <typename T> const typename assets_<T>::file_limit_t assets_<T>::file_limit;
+template <typename T> const typename assets_<T>::revalidate_t assets_<T>::revalidate;
+template <typename T> const typename assets_<T>::precompressed_t assets_<T>::precompressed;
+template <typename T> const typename assets_<T>::paths_t assets_<T>::paths;
+
+/**
+ * \ingroup configuration
+ */
+typedef assets_<> assets;
+
+/**
+ * deadlines of the phases of a connection, a zero duration disables the corresponding timeout
+ * @code
+ * server[udho::configs::timeouts::idle]   = std::chrono::milliseconds(30000); // waiting for the next request on a keep-alive connection
+ * server[udho::configs::timeouts::header] = std::chrono::milliseconds(10000); // receiving the request line and headers
+ * server[udho::configs::timeouts::body]   = std::chrono::milliseconds(60000); // receiving the request body
+ * server[udho::configs::timeouts::write]  = std::chrono::milliseconds(60000); // sending the response
+ * server[udho::configs::timeouts::drain]  = std::chrono::milliseconds(30000); // finishing the in-flight requests after SIGINT or SIGTERM
+ * @endcode
+ * \ingroup configuration
+ */
+template <typename T = void>
+struct timeouts_{
+    const static struct idle_t{
+        typedef timeouts_<T> component;
+    } idle;
+    const static struct header_t{
+        typedef timeouts_<T> component;
+    } header;
+    const static struct body_t{
+        typedef timeouts_<T> component;
+    } body;
+    const static struct write_t{
+        typedef timeouts_<T> component;
+    } write;
+    const static struct drain_t{
+        typedef timeouts_<T> component;
+    } drain;
+    
+    std::chrono::milliseconds _idle;
+    std::chrono::milliseconds _header;
+    std::chrono::milliseconds _body;
+    std::chrono::milliseconds _write;
+    std::chrono::milliseconds _drain;
+    
+    timeouts_(): _idle(30000), _header(10000), _body(60000), _write(60000), _drain(30000){}
+    
+    void set(idle_t, std::chrono::milliseconds v){_idle = v;}
+    std::chrono::milliseconds get(idle_t) const{return _idle;}
+    
+    void set(header_t, std::chrono::milliseconds v){_header = v;}
+    std::chrono::milliseconds get(header_t) const{return _header;}
+    
+    void set(body_t, std::chrono::milliseconds v){_body = v;}
+    std::chrono::milliseconds get(body_t) const{return _body;}
+    
+    void set(write_t, std::chrono::milliseconds v){_write = v;}
+    std::chrono::milliseconds get(write_t) const{return _write;}
+    
+    void set(drain_t, std::chrono::milliseconds v){_drain = v;}
+    std::chrono::milliseconds get(drain_t) const{return _drain;}
+};
+
+template <typename T> const typename timeouts_<T>::idle_t   timeouts_<T>::idle;
+template <typename T> const typename timeouts_<T>::header_t timeouts_<T>::header;
+template <typename T> const typename timeouts_<T>::body_t   timeouts_<T>::body;
+template <typename T> const typename timeouts_<T>::write_t  timeouts_<T>::write;
+template <typename T> const typename timeouts_<T>::drain_t  timeouts_<T>::drain;
+
+/**
+ * \ingroup configuration
+ */
+typedef timeouts_<> timeouts;
+
+/**
+ * worker threads that run the blocking handlers e.g. `udho::get(f).json().blocking()` off the io threads
+ * @code
+ * server[udho::configs::workers::threads] = 4;   // number of worker threads, started with the first blocking request
+ * server[udho::configs::workers::limit]   = 256; // blocking requests queued or running at once, more are answered with 503 Service Unavailable
+ * @endcode
+ * \ingroup configuration
+ */
+template <typename T = void>
+struct workers_{
+    const static struct threads_t{
+        typedef workers_<T> component;
+    } threads;
+    const static struct limit_t{
+        typedef workers_<T> component;
+    } limit;
+    
+    std::size_t _threads;
+    std::size_t _limit;
+    
+    workers_(): _threads(4), _limit(256){}
+    
+    void set(threads_t, std::size_t v){_threads = v;}
+    std::size_t get(threads_t) const{return _threads;}
+    
+    void set(limit_t, std::size_t v){_limit = v;}
+    std::size_t get(limit_t) const{return _limit;}
+};
+
+template <typename T> const typename workers_<T>::threads_t workers_<T>::threads;
+template <typename T> const typename workers_<T>::limit_t   workers_<T>::limit;
+
+/**
+ * \ingroup configuration
+ */
+typedef workers_<> workers;
+
+/**
+ * admission control and load shedding, during a spike the excess is rejected quickly instead of slowing down every request
+ * @code
+ * server[udho::configs::admission::connections] = 10000; // connections open at once, accepting pauses beyond it (0 for no limit)
+ * server[udho::configs::admission::requests]    = 1000;  // requests in flight including open streams, more are answered with 503 Service Unavailable (0 for no limit)
+ * server[udho::configs::admission::retry_after] = std::chrono::seconds(1);        // Retry-After of the 503 responses
+ * server[udho::configs::admission::target]      = std::chrono::milliseconds(5);   // queueing delay tolerated before dispatch (0 disables shedding)
+ * server[udho::configs::admission::interval]    = std::chrono::milliseconds(100); // how long the delay may stay above target before requests are shed
+ * @endcode
+ * \ingroup configuration
+ */
+template <typename T = void>
+struct admission_{
+    const static struct connections_t{
+        typedef admission_<T> component;
+    } connections;
+    const static struct requests_t{
+        typedef admission_<T> component;
+    } requests;
+    const static struct retry_after_t{
+        typedef admission_<T> component;
+    } retry_after;
+    const static struct target_t{
+        typedef admission_<T> component;
+    } target;
+    const static struct interval_t{
+        typedef admission_<T> component;
+    } interval;
+    
+    std::size_t _connections;
+    std::size_t _requests;
+    std::chrono::seconds _retry_after;
+    std::chrono::milliseconds _target;
+    std::chrono::milliseconds _interval;
+    
+    admission_(): _connections(0), _requests(0), _retry_after(1), _target(0), _interval(100){}
+    
+    void set(connections_t, std::size_t v){_connections = v;}
+    std::size_t get(connections_t) const{return _connections;}
+    
+    void set(requests_t, std::size_t v){_requests = v;}
+    std::size_t get(requests_t) const{return _requests;}
+    
+    void set(retry_after_t, std::chrono::seconds v){_retry_after = v;}
+    std::chrono::seconds get(retry_after_t) const{return _retry_after;}
+    
+    void set(target_t, std::chrono::milliseconds v){_target = v;}
+    std::chrono::milliseconds get(target_t) const{return _target;}
+    
+    void set(interval_t, std::chrono::milliseconds v){_interval = v;}
+    std::chrono::milliseconds get(interval_t) const{return _interval;}
+};
+
+template <typename T> const typename admission_<T>::connections_t admission_<T>::connections;
+template <typename T> const typename admission_<T>::requests_t    admission_<T>::requests;
+template <typename T> const typename admission_<T>::retry_after_t admission_<T>::retry_after;
+template <typename T> const typename admission_<T>::target_t      admission_<T>::target;
+template <typename T> const typename admission_<T>::interval_t    admission_<T>::interval;
+
+/**
+ * \ingroup configuration
+ */
+typedef admission_<> admission;
+}
+
 /**
  * \ingroup configuration
  */
-typedef udho::configuration<udho::configs::server, udho::configs::session, udho::configs::router, udho::configs::logger, udho::configs::form> configuration_type;
+typedef udho::configuration<udho::configs::server, udho::configs::session, udho::configs::router, udho::configs::logger, udho::configs::form, udho::configs::assets, udho::configs::timeouts, udho::configs::workers, udho::configs::admission> configuration_type;
 
 }
 
@@ -9,6 +9,9 @@
 #include <string>
 #include <thread>
 #include <vector>
+#include <deque>
+#include <chrono>
+#include <tuple>
 #include <boost/bind.hpp>
 #include <boost/format.hpp>
 #include <boost/asio/bind_executor.hpp>
@@ -20,13 +23,28 @@
 #include <boost/date_time/posix_time/posix_time_io.hpp>
 #include <boost/date_time/posix_time/posix_time_types.hpp>
 #include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
 #include <boost/asio/strand.hpp>
+#include <boost/asio/dispatch.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/optional.hpp>
 #include <boost/config.hpp>
 #include <udho/context.h>
 #include <udho/logging.h>
 #include <udho/page.h>
 #include <udho/defs.h>
 #include <udho/util.h>
+#include <udho/sendfile.h>
+#include <udho/assets.h>
+#include <udho/compression.h>
+#include <udho/metrics.h>
+#include <udho/registry.h>
+#include <udho/admission.h>
+#include <udho/arena.h>
+#include <udho/headers.h>
+#include <udho/endpoint.h>
+#include <udho/stream.h>
+#include <udho/websocket.h>
 
 namespace udho{
     
@@ -35,28 +53,91 @@ namespace http = boost::beast::http;
 
 /**
  * Stateful HTTP Session
+ * @tparam ProtocolT stream protocol of the socket, `boost::asio::ip::tcp` or `boost::asio::local::stream_protocol`
  * \ingroup server
  */
-template <typename RouterT, typename AttachmentT>
-class connection : public std::enable_shared_from_this<connection<RouterT, AttachmentT>>{
+template <typename RouterT, typename AttachmentT, typename ProtocolT = boost::asio::ip::tcp>
+class connection : public std::enable_shared_from_this<connection<RouterT, AttachmentT, ProtocolT>>{
     typedef typename AttachmentT::auxiliary_type auxiliary_type;
 #if (BOOST_VERSION / 1000 >=1 && BOOST_VERSION / 100 % 1000 >= 70)
-    typedef boost::asio::basic_stream_socket<boost::asio::ip::tcp, boost::asio::io_context::executor_type> socket_type;
+    typedef boost::asio::basic_stream_socket<ProtocolT, boost::asio::io_context::executor_type> socket_type;
 #else
-    typedef boost::asio::basic_stream_socket<boost::asio::ip::tcp> socket_type;
+    typedef boost::asio::basic_stream_socket<ProtocolT> socket_type;
 #endif
     
     RouterT& _router;
     AttachmentT& _attachment;
-    typedef connection<RouterT, AttachmentT> self_type;
+    typedef connection<RouterT, AttachmentT, ProtocolT> self_type;
     typedef AttachmentT attachment_type;
     typedef typename attachment_type::shadow_type shadow_type;
     typedef udho::context<auxiliary_type, udho::defs::request_type, shadow_type> context_type;
+    typedef http::request_parser<udho::defs::request_type::body_type, udho::defs::fields_type::allocator_type> parser_type;
     
+    /**
+     * phases of a connection with a deadline
+     */
+    enum class phase{
+        idle,   ///< waiting for the first byte of the next request
+        header, ///< receiving the request line and headers
+        body,   ///< receiving the request body
+        write   ///< sending the response
+    };
+    
+    /**
+     * a chunk of a streamed body along with the handler to call once it is written
+     */
+    struct piece{
+        std::shared_ptr<const std::string> _data;
+        udho::stream::handler_type         _handler;
+        bool                       _last;
+    };
+    
+    /**
+     * a request read from the connection along with its response, kept until the response is written
+     */
+    struct exchange{
+        udho::defs::request_type _req;
+        boost::posix_time::ptime _time;
+        std::shared_ptr<void>    _response;
+        std::function<void ()>   _write;
+        bool                     _responded;
+        const void*              _stream;    ///< channel of the streamed response, if the response is streamed
+        std::deque<piece>        _pieces;    ///< chunks of the streamed body that are not written yet
+        bool                     _streaming; ///< the headers of the streamed response have been written
+        bool                     _finished;  ///< the last chunk of the streamed body has been queued
+        bool                     _busy;      ///< a chunk of the streamed body is being written
+        udho::admission::ticket  _ticket;    ///< slot among the requests in flight, released once the response is written
+        
+        exchange(): _responded(false), _stream(nullptr), _streaming(false), _finished(false), _busy(false){}
+    };
+    
+    /**
+     * connection side of a udho::stream. Keeps the connection alive as long as the handler holds the stream.
+     */
+    struct channel: udho::stream::channel{
+        std::shared_ptr<self_type> _self;
+        std::shared_ptr<exchange>  _exchange;
+        
+        channel(std::shared_ptr<self_type> self, std::shared_ptr<exchange> x): _self(self), _exchange(x){}
+        ~channel(){
+            boost::asio::post(_self->_strand, std::bind(&self_type::abandon, _self, _exchange, static_cast<const void*>(this)));
+        }
+        void write(std::shared_ptr<const std::string> chunk, udho::stream::handler_type handler) override{
+            boost::asio::dispatch(_self->_strand, std::bind(&self_type::push, _self, _exchange, static_cast<const void*>(this), chunk, handler, false));
+        }
+        void finish(udho::stream::handler_type handler) override{
+            boost::asio::dispatch(_self->_strand, std::bind(&self_type::push, _self, _exchange, static_cast<const void*>(this), std::shared_ptr<const std::string>(), handler, true));
+        }
+    };
+    
+    /**
+     * hands the response of an exchange to the connection, which writes it after the responses of the earlier requests
+     */
     struct send_lambda{
         self_type& self_;
+        std::shared_ptr<exchange> _exchange;
 
-        explicit send_lambda(self_type& self): self_(self){}
+        send_lambda(self_type& self, std::shared_ptr<exchange> x): self_(self), _exchange(x){}
 
         template<bool isRequest, class Body, class Fields>
         void operator()(http::message<isRequest, Body, Fields>& msg) const {
@@ -66,18 +147,55 @@ class connection : public std::enable_shared_from_this<connection<RouterT, Attac
         template<bool isRequest, class Body, class Fields>
         void operator()(http::message<isRequest, Body, Fields>&& msg) const {
             auto sp = std::make_shared<http::message<isRequest, Body, Fields>>(std::move(msg));
-            self_.res_ = sp;
-            http::async_write(self_._socket, *sp, boost::asio::bind_executor(self_._strand, std::bind(&self_type::on_write, self_.shared_from_this(), std::placeholders::_1, std::placeholders::_2, sp->need_eof())));
+            self_type* self = &self_;
+            self_.enqueue(_exchange, sp, [self, sp](){
+                if(self->_draining) sp->keep_alive(false);
+                http::async_write(self->_socket, *sp, boost::asio::bind_executor(self->_strand, std::bind(&self_type::on_write, self->shared_from_this(), std::placeholders::_1, std::placeholders::_2, sp->need_eof())));
+            });
+        }
+        /**
+         * file responses, including the ones returned by bridge::file, are transferred with sendfile where available
+         */
+        template<class Fields>
+        void operator()(http::response<http::file_body, Fields>&& msg) const {
+            file(std::make_shared<http::response<http::file_body, Fields>>(std::move(msg)));
+        }
+        template<class Fields>
+        void operator()(http::response<udho::ranged_file_body, Fields>&& msg) const {
+            file(std::make_shared<http::response<udho::ranged_file_body, Fields>>(std::move(msg)));
+        }
+      private:
+        template<class Body, class Fields>
+        void file(std::shared_ptr<http::response<Body, Fields>> sp) const {
+            self_type* self = &self_;
+            self_.enqueue(_exchange, sp, [self, sp](){
+                if(self->_draining) sp->keep_alive(false);
+                udho::async_write_file(self->_socket, sp, boost::asio::bind_executor(self->_strand, std::bind(&self_type::on_write, self->shared_from_this(), std::placeholders::_1, std::placeholders::_2, sp->need_eof())));
+            });
         }
     };
 
     socket_type _socket;
     boost::asio::strand<boost::asio::io_context::executor_type> _strand;
     boost::beast::flat_buffer _buffer;
-    udho::defs::request_type _req;
-    std::shared_ptr<void> res_;
-    send_lambda _lambda;
-    boost::posix_time::ptime _time;
+    std::shared_ptr<udho::arena> _arena; ///< fields of the requests, their contexts and the responses composed by the connection, rewound between keep-alive requests
+    boost::optional<parser_type> _parser;
+    std::size_t _received;
+    std::deque<std::shared_ptr<exchange>> _exchanges; ///< requests in the order they have been read, whose responses are not written yet
+    bool _reading;  ///< a request is being read
+    bool _waiting;  ///< waiting for the first byte of the next request
+    bool _paused;   ///< reading stopped because the pipeline is full
+    bool _writing;  ///< the response of the first exchange is being written
+    bool _eof;      ///< the peer will not send more requests
+    bool _closing;
+    bool _upgrading; ///< the last request read is being upgraded to a websocket, no further requests are read
+    bool _draining;  ///< the server is shutting down, the pending responses are written with Connection: close and no further requests are read
+    bool _sampled;   ///< the request was complete with its headers, so the time until it is dispatched is its queueing delay
+    std::chrono::steady_clock::time_point _ready; ///< when the headers of the request being read were received
+    udho::registry::membership _membership; ///< keeps the connection counted among the live connections of the server
+    boost::asio::steady_timer _timer;       ///< deadline of reading
+    boost::asio::steady_timer _write_timer; ///< deadline of writing
+    phase _phase;
   public:
     /**
      * session constructor
@@ -89,60 +207,319 @@ class connection : public std::enable_shared_from_this<connection<RouterT, Attac
           _attachment(attachment),
           _socket(std::move(socket)),
           _strand(_socket.get_executor()),
-          _lambda(*this),
-          _time(boost::posix_time::second_clock::local_time())
+          _arena(std::make_shared<udho::arena>()),
+          _received(0),
+          _reading(false),
+          _waiting(false),
+          _paused(false),
+          _writing(false),
+          _eof(false),
+          _closing(false),
+          _upgrading(false),
+          _draining(false),
+          _sampled(false),
+          _timer(_socket.get_executor()),
+          _write_timer(_socket.get_executor()),
+          _phase(phase::idle)
           {}
     ~connection(){
         // std::cout << "destructing connection" << std::endl;
     }
     /**
-     * start the read loop
+     * registers the connection as live and starts the read loop
      */
     void run(){
+        std::weak_ptr<self_type> weak = std::enable_shared_from_this<connection<RouterT, AttachmentT, ProtocolT>>::shared_from_this();
+        _membership = _attachment.aux().connections().enter([weak](){
+            std::shared_ptr<self_type> self = weak.lock();
+            if(self){
+                boost::asio::dispatch(self->_strand, std::bind(&self_type::retire, self));
+            }
+        });
         do_read();
     }
+    /**
+     * the server is shutting down: no further requests are read and the connection is closed once the responses of the pending requests are written, each with Connection: close.
+     * A keep-alive connection waiting for its next request is closed right away.
+     */
+    void retire(){
+        if(_closing || _draining){
+            return;
+        }
+        _draining = true;
+        _eof = true;
+        if(_waiting && _exchanges.empty()){
+            boost::system::error_code ec;
+            _attachment << udho::logging::messages::formatted::info("connection", "closing idle connection %1% while draining") % udho::internal::peer(_socket.remote_endpoint(ec));
+            abort();
+        }
+    }
+    /**
+     * reads the next request, which may arrive before the responses of the earlier ones have been written (pipelining).
+     * Waits for it within the idle timeout, unless some of it has already been received or earlier requests are still pending.
+     */
     void do_read(){
-        _req = {};
-        http::async_read(_socket, _buffer, _req, boost::asio::bind_executor(_strand, std::bind(&self_type::on_read, std::enable_shared_from_this<connection<RouterT, AttachmentT>>::shared_from_this(), std::placeholders::_1, std::placeholders::_2)));
+        if(_closing){
+            return;
+        }
+        _received = 0;
+        _reading  = true;
+        _paused   = false;
+        if(_buffer.size() > 0){
+            return do_read_header();
+        }
+        _waiting = true;
+        if(_exchanges.empty()){
+            expect(phase::idle);
+        }else{
+            _phase = phase::idle;
+            disarm(phase::idle);
+        }
+        _socket.async_wait(socket_type::wait_read, boost::asio::bind_executor(_strand, std::bind(&self_type::on_readable, std::enable_shared_from_this<connection<RouterT, AttachmentT, ProtocolT>>::shared_from_this(), std::placeholders::_1)));
+    }
+    void on_readable(boost::system::error_code ec){
+        _waiting = false;
+        if(ec || _draining){
+            _reading = false;
+            return disarm(phase::idle);
+        }
+        do_read_header();
+    }
+    /**
+     * the parser is set up once the request starts to arrive, by then the earlier exchanges have usually been released and the arena is rewound
+     */
+    void do_read_header(){
+        _parser.reset();
+        _arena->reset();
+        _parser.emplace(std::piecewise_construct, std::make_tuple(), std::make_tuple(udho::arena_allocator<char>(_arena)));
+        expect(phase::header);
+        http::async_read_header(_socket, _buffer, *_parser, boost::asio::bind_executor(_strand, std::bind(&self_type::on_header, std::enable_shared_from_this<connection<RouterT, AttachmentT, ProtocolT>>::shared_from_this(), std::placeholders::_1, std::placeholders::_2)));
+    }
+    void on_header(boost::system::error_code ec, std::size_t bytes_transferred){
+        _received = bytes_transferred;
+        if(ec){
+            return on_failure(ec);
+        }
+        _ready   = std::chrono::steady_clock::now();
+        _sampled = _parser->is_done();
+        expect(phase::body);
+        http::async_read(_socket, _buffer, *_parser, boost::asio::bind_executor(_strand, std::bind(&self_type::on_body, std::enable_shared_from_this<connection<RouterT, AttachmentT, ProtocolT>>::shared_from_this(), std::placeholders::_1, std::placeholders::_2)));
     }
-    void on_read(boost::system::error_code ec, std::size_t bytes_transferred){
+    void on_body(boost::system::error_code ec, std::size_t bytes_transferred){
         boost::ignore_unused(bytes_transferred);
+        disarm(phase::body);
+        if(ec){
+            return on_failure(ec);
+        }
+        _reading = false;
+        std::shared_ptr<exchange> x = std::make_shared<exchange>();
+        x->_req  = _parser->release();
+        x->_time = boost::posix_time::second_clock::local_time();
+        _exchanges.push_back(x);
+        if(admit(x)){
+            on_read(x);
+        }
+        // a request that asks to close the connection is the last one to be read
+        if(x->_req.keep_alive()){
+            resume();
+        }
+    }
+    /**
+     * continues reading unless the connection is closing, a read is in progress or the pipeline is full
+     */
+    void resume(){
+        if(_closing || _eof || _reading || _upgrading){
+            return;
+        }
+        const udho::configs::server& server_config = _attachment.aux().config();
+        if(_exchanges.size() >= std::max<std::size_t>(server_config.get(udho::configs::server::pipeline), 1)){
+            _paused = true;
+            return;
+        }
+        do_read();
+    }
+    /**
+     * a request could not be read because the peer closed the connection, a deadline expired or the request was malformed
+     */
+    void on_failure(boost::system::error_code ec){
+        _reading = false;
+        disarm(phase::body);
         if(ec == http::error::end_of_stream){
-            return do_close();
+            // the peer will not send more requests, but still reads the responses of the pending ones
+            _eof = true;
+            if(_exchanges.empty()){
+                do_close();
+            }
+            return;
         }
-        if(bytes_transferred == 0 || ec == boost::asio::error::connection_reset){
+        if(ec != boost::asio::error::operation_aborted && ec != boost::asio::error::connection_reset && ec != boost::asio::error::eof){
+            _attachment << udho::logging::messages::formatted::warning("connection", "closing connection after failing to read a request %1%") % ec.message();
+            do_close();
+        }
+    }
+    /**
+     * stores the response of an exchange and writes the responses that are due.
+     * A second response to the same request or a response after the connection closed is rejected.
+     * @param write starts writing the response
+     * @return false if the response has been rejected
+     */
+    bool enqueue(std::shared_ptr<exchange> x, std::shared_ptr<void> response, std::function<void ()> write){
+        if(x->_responded || _closing){
+            _attachment.aux().metrics().increment(udho::metrics::rejected_responses);
+            _attachment << udho::logging::messages::formatted::warning("connection", "rejected response to %1% %2% %3%") % x->_req.method() % x->_req.target() % (x->_responded ? "that has already been responded" : "after the connection closed");
+            return false;
+        }
+        x->_responded = true;
+        x->_response = response;
+        x->_write    = write;
+        flush();
+        return true;
+    }
+    /**
+     * writes the response of the earliest pending request if it is ready and nothing is being written
+     */
+    void flush(){
+        if(_writing || _closing || _exchanges.empty() || !_exchanges.front()->_write){
             return;
         }
-        boost::asio::ip::tcp::endpoint remote = _socket.remote_endpoint(ec);
+        _writing = true;
+        expect(phase::write);
+        std::function<void ()> write = std::move(_exchanges.front()->_write);
+        _exchanges.front()->_write = nullptr;
+        write();
+    }
+    boost::asio::steady_timer& timer(phase p){
+        return p == phase::write ? _write_timer : _timer;
+    }
+    /**
+     * arms the deadline of the phase the connection enters, as configured in udho::configs::timeouts
+     */
+    void expect(phase p){
+        const udho::configs::timeouts& timeouts = _attachment.aux().config();
+        std::chrono::milliseconds duration(0);
+        switch(p){
+            case phase::idle:   duration = timeouts.get(udho::configs::timeouts::idle);   break;
+            case phase::header: duration = timeouts.get(udho::configs::timeouts::header); break;
+            case phase::body:   duration = timeouts.get(udho::configs::timeouts::body);   break;
+            case phase::write:  duration = timeouts.get(udho::configs::timeouts::write);  break;
+        }
+        if(p != phase::write){
+            _phase = p;
+        }
+        if(duration.count() <= 0){
+            return disarm(p);
+        }
+        timer(p).expires_after(duration);
+        timer(p).async_wait(boost::asio::bind_executor(_strand, std::bind(&self_type::on_timeout, std::enable_shared_from_this<connection<RouterT, AttachmentT, ProtocolT>>::shared_from_this(), std::placeholders::_1, p == phase::write)));
+    }
+    void disarm(phase p){
+        timer(p).expires_at(boost::asio::steady_timer::time_point::max());
+    }
+    void on_timeout(boost::system::error_code ec, bool writing){
+        boost::asio::steady_timer& expired = writing ? _write_timer : _timer;
+        if(ec == boost::asio::error::operation_aborted || expired.expiry() > boost::asio::steady_timer::clock_type::now()){
+            return;
+        }
+        udho::metrics::counter counter = udho::metrics::write_timeouts;
+        if(!writing){
+            switch(_phase){
+                case phase::idle:   counter = udho::metrics::idle_timeouts;   break;
+                case phase::header: counter = udho::metrics::header_timeouts; break;
+                case phase::body:   counter = udho::metrics::body_timeouts;   break;
+                case phase::write:  counter = udho::metrics::write_timeouts;  break;
+            }
+        }
+        _attachment.aux().metrics().increment(counter);
+        _attachment << udho::logging::messages::formatted::info("connection", "closing connection after %1%") % udho::metrics::name(counter);
+        abort();
+    }
+    /**
+     * closes the connection without writing the pending responses
+     */
+    void abort(){
+        _closing = true;
+        disarm(phase::idle);
+        disarm(phase::write);
+        discard();
+        boost::system::error_code err;
+        _socket.shutdown(socket_type::shutdown_both, err);
+        _socket.close(err);
+    }
+    /**
+     * drops the pending exchanges, the handlers of the unwritten chunks of a streamed body are called with operation_aborted
+     */
+    void discard(){
+        for(const std::shared_ptr<exchange>& x: _exchanges){
+            for(const piece& p: x->_pieces){
+                if(p._handler){
+                    boost::asio::post(_strand, std::bind(p._handler, boost::system::error_code(boost::asio::error::operation_aborted)));
+                }
+            }
+            x->_pieces.clear();
+            x->_ticket.release();
+        }
+        _exchanges.clear();
+    }
+    /**
+     * takes a slot among the requests in flight and consults the load shedding, whose queueing delay is sampled from the requests without a body:
+     * the time between receiving their headers and dispatching them is spent waiting in the queue of the io_context.
+     * A request that is not admitted is answered with 503 Service Unavailable and Retry-After without being routed.
+     */
+    bool admit(std::shared_ptr<exchange> x){
+        const udho::configs::admission& options = _attachment.aux().config();
+        x->_ticket = _attachment.aux().admission().enter(options.get(udho::configs::admission::requests));
+        const char* reason = nullptr;
+        if(!x->_ticket){
+            reason = "too many requests in flight";
+        }else if(_sampled && !_attachment.aux().admit(std::chrono::steady_clock::now() - _ready)){
+            reason = "queueing delay above target";
+        }
+        if(!reason){
+            return true;
+        }
+        boost::system::error_code ec;
+        _attachment << udho::logging::messages::formatted::warning("connection", "%1% %2% %3% shed, %4%") % udho::internal::peer(_socket.remote_endpoint(ec)) % x->_req.method() % x->_req.target() % reason;
+        send_lambda(*this, x)(_attachment.aux().shed(reason).response(x->_req));
+        return false;
+    }
+    /**
+     * routes a request that has been read, its response is written once the responses of the earlier requests are written
+     */
+    void on_read(std::shared_ptr<exchange> x){
+        const udho::defs::request_type& req = x->_req;
+        send_lambda send(*this, x);
+        boost::system::error_code ec;
+        typename ProtocolT::endpoint endpoint = _socket.remote_endpoint(ec);
         if(ec){
             _attachment << udho::logging::messages::formatted::error("connection", "Unexpected error while retrieving socket remote endpoint %1%") % ec;
             return do_close();
         }
-        _time = boost::posix_time::second_clock::local_time();
+        std::string remote = udho::internal::peer(endpoint);
         
-        std::string path;
-        std::stringstream path_stream(_req.target().to_string());
-        std::getline(path_stream, path, '?');
+        boost::string_view target = req.target();
+        std::string path = target.substr(0, target.find('?')).to_string();
         auto start = std::chrono::high_resolution_clock::now();
         try{
-            context_type ctx(_attachment.aux(), _req, _attachment.shadow());
+            context_type ctx(_attachment.aux(), req, _attachment.shadow());
             ctx.attach(_attachment);
-            ctx._pimpl->_respond.connect(std::bind(&self_type::respond, std::enable_shared_from_this<connection<RouterT, AttachmentT>>::shared_from_this(), std::placeholders::_1));
+            ctx._pimpl->_respond.connect(std::bind(&self_type::respond, std::enable_shared_from_this<connection<RouterT, AttachmentT, ProtocolT>>::shared_from_this(), x, std::placeholders::_1));
+            ctx._pimpl->_stream.connect(std::bind(&self_type::open, std::enable_shared_from_this<connection<RouterT, AttachmentT, ProtocolT>>::shared_from_this(), x, std::placeholders::_1));
+            ctx._pimpl->_upgrade.connect(std::bind(&self_type::upgrade, std::enable_shared_from_this<connection<RouterT, AttachmentT, ProtocolT>>::shared_from_this(), x, std::placeholders::_1));
             int status = 0;
             do{
                 if(ctx.rerouted()){
                     if(!ctx.reroutes()){
-                        _attachment << udho::logging::messages::formatted::error("router", "Error expecting rerouted context but got empty stack while serving %1%") % _req.target().to_string();
-                        throw exceptions::http_error(boost::beast::http::status::internal_server_error, (boost::format("Error expecting rerouted context but got empty stack while serving %1%") % _req.target().to_string()).str());
+                        _attachment << udho::logging::messages::formatted::error("router", "Error expecting rerouted context but got empty stack while serving %1%") % req.target().to_string();
+                        throw exceptions::http_error(boost::beast::http::status::internal_server_error, (boost::format("Error expecting rerouted context but got empty stack while serving %1%") % req.target().to_string()).str());
                     }
                     
                     udho::detail::route last = ctx.top();
                     path = boost::regex_replace(last._subject, boost::regex(last._pattern), ctx.alt_path());
-                    _attachment << udho::logging::messages::formatted::info("router", "%1% %2% %3% rerouted to %4%") % remote.address() % _req.method() % last._path % path;
+                    _attachment << udho::logging::messages::formatted::info("router", "%1% %2% %3% rerouted to %4%") % remote % req.method() % last._path % path;
                     ctx.clear();
                 }
                 try{
-                    status = _router.serve(ctx, _req.method(), path, _lambda);
+                    status = _router.serve(ctx, req.method(), path, send);
                 }catch(const udho::exceptions::reroute& rerouted){
                     ctx.reroute(rerouted.alt_path());
                 }
@@ -152,89 +529,302 @@ class connection : public std::enable_shared_from_this<connection<RouterT, Attac
             std::chrono::microseconds ms = std::chrono::duration_cast<std::chrono::microseconds>(delta);
              
             if(status == -102){ // ROUTING_DEFERRED
-                _attachment << udho::logging::messages::formatted::info("router", "%1% %2% %3% deferred") % remote.address() % _req.method() % path;
+                _attachment << udho::logging::messages::formatted::info("router", "%1% %2% %3% deferred") % remote % req.method() % path;
                 return;
             }
             
             if(status == 0){
-                boost::filesystem::path doc_root = _attachment.aux().docroot();
-                boost::filesystem::path local_path = internal::path_cat(doc_root, path);
-                if(!internal::path_inside(doc_root, local_path)){
-                    _attachment << udho::logging::messages::formatted::warning("router", "%1% %2% %3% access denied for %4%") % remote.address() % _req.method() % path % local_path;
+                udho::path_cache& paths = _attachment.aux().paths();
+                const udho::configs::assets& assets_options = _attachment.aux().config();
+                boost::filesystem::path local_path;
+                if(!paths.locate(_attachment.aux().docroot(), path, local_path)){
+                    _attachment << udho::logging::messages::formatted::warning("router", "%1% %2% %3% access denied for %4%") % remote % req.method() % path % local_path;
                     throw exceptions::http_error(boost::beast::http::status::forbidden, (boost::format("Access denied to %1%") % local_path).str());
                 }
+                if(!paths.exists(local_path, assets_options)){
+                    _attachment << udho::logging::messages::formatted::warning("router", "%1% %2% %3% not found %4% %5%μs") % remote % req.method() % path % local_path % ms.count();
+                    throw exceptions::http_error(boost::beast::http::status::not_found);
+                }
                 std::string extension = local_path.extension().string();
                 std::string mime_type = _attachment.aux().config()[udho::configs::server::mime_default];
                 if(!extension.empty() && extension.front() == '.'){
                     extension = extension.substr(1);
                     mime_type = _attachment.aux().config()[udho::configs::server::mimes].of(extension);
                 }
-                _attachment << udho::logging::messages::formatted::info("router", "%1% %2% %3% looking for %4%") % remote.address() % _req.method() % path % local_path;
+                const bool negotiable = assets_options.get(udho::configs::assets::precompressed);
+                std::string content_encoding;
+                if(negotiable){
+                    content_encoding = udho::compression::precompressed(local_path, req[http::field::accept_encoding].to_string(), [&](const boost::filesystem::path& sibling){
+                        return paths.exists(sibling, assets_options);
+                    });
+                }
+                _attachment << udho::logging::messages::formatted::info("router", "%1% %2% %3% looking for %4%") % remote % req.method() % path % local_path;
+                if(assets_options.get(udho::configs::assets::cache)){
+                    std::shared_ptr<const udho::asset> cached = _attachment.aux().assets().fetch(local_path, mime_type, assets_options);
+                    if(cached){
+                        _attachment << udho::logging::messages::formatted::info("router", "%1% %2% %3% found %4% in cache") % remote % req.method() % path % local_path;
+                        return serve_asset(req, send, *cached, negotiable, content_encoding);
+                    }
+                }
                 boost::beast::error_code err;
-                http::file_body::value_type body;
-                body.open(local_path.c_str(), boost::beast::file_mode::scan, err);
+                http::response<udho::ranged_file_body, udho::defs::fields_type> res = reply<udho::ranged_file_body>(http::status::ok, req.version());
+                res.body().open(local_path.c_str(), err);
                 if(err == boost::system::errc::no_such_file_or_directory){
-                    _attachment << udho::logging::messages::formatted::warning("router", "%1% %2% %3% not found %4% %5%μs") % remote.address() % _req.method() % path % local_path % ms.count();
+                    paths.forget(local_path);
+                    _attachment << udho::logging::messages::formatted::warning("router", "%1% %2% %3% not found %4% %5%μs") % remote % req.method() % path % local_path % ms.count();
                     throw exceptions::http_error(boost::beast::http::status::not_found);
                 }else{
-                    _attachment << udho::logging::messages::formatted::info("router", "%1% %2% %3% found %4%") % remote.address() % _req.method() % path % local_path;
+                    _attachment << udho::logging::messages::formatted::info("router", "%1% %2% %3% found %4%") % remote % req.method() % path % local_path;
                 }
                 if(err){
-                    _attachment << udho::logging::messages::formatted::warning("router", "%1% %2% %3% %4%μs") % remote.address() % _req.method() % path % ms.count();
+                    _attachment << udho::logging::messages::formatted::warning("router", "%1% %2% %3% %4%μs") % remote % req.method() % path % ms.count();
                     throw exceptions::http_error(boost::beast::http::status::internal_server_error, (boost::format("Error %1% while reading file `%2%` from disk") % err % local_path).str());
                 }
-                auto const size = body.size();
-                if(_req.method() == boost::beast::http::verb::head){
-                    http::response<boost::beast::http::string_body> res{http::status::ok, _req.version()};
-                    res.set(http::field::server, UDHO_VERSION_STRING);
-                    res.set(http::field::content_type, mime_type);
-                    res.content_length(size);
-                    res.keep_alive(_req.keep_alive());
-                    _attachment << udho::logging::messages::formatted::info("router", "%1% %2% %3% %4% %5% %6%μs") % remote.address() % 200 % http::status::ok % _req.method() % path % ms.count();
-                    _lambda(std::move(res));
-                    return;
+                udho::headers::stamp(res, mime_type);
+                internal::file_validators(res, local_path);
+                if(negotiable){
+                    udho::compression::negotiated(res, content_encoding);
+                }
+                res.keep_alive(req.keep_alive());
+                udho::select_ranges(res, req, mime_type);
+                if(req.method() == boost::beast::http::verb::head){
+                    _attachment << udho::logging::messages::formatted::info("router", "%1% %2% %3% %4% %5% %6%μs") % remote % res.result_int() % res.result() % req.method() % path % ms.count();
                 }
-                // Respond to GET request
-                http::response<http::file_body> res{std::piecewise_construct, std::make_tuple(std::move(body)), std::make_tuple(http::status::ok, _req.version())};
-                res.set(http::field::server, UDHO_VERSION_STRING);
-                res.set(http::field::content_type, mime_type);
-                res.content_length(size);
-                res.keep_alive(_req.keep_alive());
-                return _lambda(std::move(res));
+                return send(std::move(res));
             }else{
                 http::status response = static_cast<http::status>(status);
-                _attachment << udho::logging::messages::formatted::info("router", "%1% %2% %3% %4% %5% %6%μs") % remote.address() % status % response % _req.method() % path % ms.count();
+                _attachment << udho::logging::messages::formatted::info("router", "%1% %2% %3% %4% %5% %6%μs") % remote % status % response % req.method() % path % ms.count();
             }
         }catch(const exceptions::http_error& ex){
-            auto res = ex.response(_req, _router);
+            auto res = ex.response(req, _router);
             auto end = std::chrono::high_resolution_clock::now();
             std::chrono::duration<double> delta = end - start;
             std::chrono::microseconds ms = std::chrono::duration_cast<std::chrono::microseconds>(delta);
-            _attachment << udho::logging::messages::formatted::warning("router", "%1% %2% %3% %4% %5% %6%μs") % remote.address() % (int) ex.result() % ex.result() % _req.method() % path % ms.count();
-            return _lambda(std::move(res));
+            _attachment << udho::logging::messages::formatted::warning("router", "%1% %2% %3% %4% %5% %6%μs") % remote % (int) ex.result() % ex.result() % req.method() % path % ms.count();
+            return send(std::move(res));
         }
     }
-    void on_write(boost::system::error_code /*ec*/, std::size_t bytes_transferred, bool close){
+    /**
+     * an empty response composed by the connection itself, whose header fields are allocated from the arena
+     */
+    template <typename BodyT>
+    http::response<BodyT, udho::defs::fields_type> reply(http::status status, unsigned version) const{
+        http::response<BodyT, udho::defs::fields_type> res{std::piecewise_construct, std::make_tuple(), std::make_tuple(udho::arena_allocator<char>(_arena))};
+        res.result(status);
+        res.version(version);
+        return res;
+    }
+    /**
+     * responds with a static file held in the asset cache, or with 304 Not Modified if the request's validators match
+     * 
+     * @param negotiable whether the file is one of the precompressed representations of the requested resource
+     * @param content_encoding content coding of the cached file, empty for identity
+     */
+    void serve_asset(const udho::defs::request_type& req, send_lambda& send, const udho::asset& cached, bool negotiable, const std::string& content_encoding){
+        if(cached.not_modified(req)){
+            http::response<http::empty_body, udho::defs::fields_type> res = reply<http::empty_body>(http::status::not_modified, req.version());
+            udho::headers::stamp(res);
+            res.set(http::field::etag, cached._etag);
+            res.set(http::field::last_modified, cached._last_modified);
+            if(negotiable){
+                res.set(http::field::vary, "Accept-Encoding");
+            }
+            res.keep_alive(req.keep_alive());
+            return send(std::move(res));
+        }
+        http::response<udho::ranged_file_body, udho::defs::fields_type> res = reply<udho::ranged_file_body>(http::status::ok, req.version());
+        udho::headers::stamp(res, cached._mime);
+        res.set(http::field::etag, cached._etag);
+        res.set(http::field::last_modified, cached._last_modified);
+        if(negotiable){
+            udho::compression::negotiated(res, content_encoding);
+        }
+        res.keep_alive(req.keep_alive());
+        res.body().assign(cached._content);
+        udho::select_ranges(res, req, cached._mime);
+        send(std::move(res));
+    }
+    void on_write(boost::system::error_code ec, std::size_t bytes_transferred, bool close){
         boost::ignore_unused(bytes_transferred);
-        if(close){
+        disarm(phase::write);
+        _writing = false;
+        if(ec){
+            _closing = true;
+            discard();
+            return;
+        }
+        if(!_exchanges.empty()){
+            _exchanges.front()->_ticket.release();
+            _exchanges.pop_front();
+        }
+        if(close || (_eof && _exchanges.empty())){
             return do_close();
         }
-        res_ = nullptr;
-        do_read();
+        flush();
+        if(_paused){
+            resume();
+        }else if(_waiting && _exchanges.empty()){
+            expect(phase::idle);
+        }
     }
     void do_close(){
+        _closing = true;
+        disarm(phase::idle);
+        disarm(phase::write);
+        discard();
         boost::system::error_code ec;
-        _socket.shutdown(tcp::socket::shutdown_send, ec);
+        if(_waiting){
+            // no further request is read, stop waiting for one so that the connection is released
+            _socket.cancel(ec);
+        }
+        _socket.shutdown(socket_type::shutdown_send, ec);
+    }
+    /**
+     * response of a deferred request through ctx.respond(), which may be called from any thread.
+     * The response is moved and delivered on the strand of the connection.
+     */
+    void respond(std::shared_ptr<exchange> x, udho::defs::response_type& msg){
+        std::shared_ptr<udho::defs::response_type> response = std::make_shared<udho::defs::response_type>(std::move(msg));
+        boost::asio::dispatch(_strand, std::bind(&self_type::deliver, std::enable_shared_from_this<connection<RouterT, AttachmentT, ProtocolT>>::shared_from_this(), x, response));
     }
-    void respond(udho::defs::response_type& msg){
-        std::string path;
-        std::stringstream path_stream(_req.target().to_string());
-        std::getline(path_stream, path, '?');
+    void deliver(std::shared_ptr<exchange> x, std::shared_ptr<udho::defs::response_type> response){
+        boost::string_view target = x->_req.target();
+        std::string path = target.substr(0, target.find('?')).to_string();
         
-        boost::posix_time::time_duration diff = boost::posix_time::second_clock::local_time() - _time;
+        boost::posix_time::time_duration diff = boost::posix_time::second_clock::local_time() - x->_time;
         
-        _attachment << udho::logging::messages::formatted::info("router", "%1% %2% %3% responded after %4% delay") % _socket.remote_endpoint().address() % _req.method() % path % diff;
-        _lambda(std::move(msg));
+        boost::system::error_code ec;
+        _attachment << udho::logging::messages::formatted::info("router", "%1% %2% %3% responded after %4% delay") % udho::internal::peer(_socket.remote_endpoint(ec)) % x->_req.method() % path % diff;
+        send_lambda(*this, x)(std::move(*response));
+    }
+    /**
+     * streamed response of a deferred request through ctx.stream(), which may be called from any thread
+     */
+    void open(std::shared_ptr<exchange> x, udho::stream& stream){
+        std::shared_ptr<channel> chan = std::make_shared<channel>(std::enable_shared_from_this<connection<RouterT, AttachmentT, ProtocolT>>::shared_from_this(), x);
+        std::shared_ptr<udho::stream::header_type> header = std::make_shared<udho::stream::header_type>(stream.header());
+        stream.attach(chan);
+        boost::asio::dispatch(_strand, std::bind(&self_type::begin, std::enable_shared_from_this<connection<RouterT, AttachmentT, ProtocolT>>::shared_from_this(), x, static_cast<const void*>(chan.get()), header));
+    }
+    /**
+     * queues the headers of a streamed response, the body is chunked for HTTP/1.1 and delimited by closing the connection otherwise
+     */
+    void begin(std::shared_ptr<exchange> x, const void* chan, std::shared_ptr<udho::stream::header_type> header){
+        if(x->_req.version() >= 11){
+            header->chunked(true);
+        }else{
+            header->keep_alive(false);
+        }
+        std::shared_ptr<http::response_serializer<http::empty_body>> sr = std::make_shared<http::response_serializer<http::empty_body>>(*header);
+        self_type* self = this;
+        bool accepted = enqueue(x, header, [self, x, header, sr](){
+            if(self->_draining) header->keep_alive(false);
+            http::async_write_header(self->_socket, *sr, boost::asio::bind_executor(self->_strand, std::bind(&self_type::on_head, self->shared_from_this(), x, sr, std::placeholders::_1, std::placeholders::_2)));
+        });
+        if(accepted){
+            x->_stream = chan;
+            boost::system::error_code ec;
+            _attachment << udho::logging::messages::formatted::info("router", "%1% %2% %3% streaming") % udho::internal::peer(_socket.remote_endpoint(ec)) % x->_req.method() % x->_req.target();
+        }
+    }
+    void on_head(std::shared_ptr<exchange> x, std::shared_ptr<http::response_serializer<http::empty_body>> /*sr*/, boost::system::error_code ec, std::size_t bytes_transferred){
+        if(ec){
+            return on_write(ec, bytes_transferred, true);
+        }
+        x->_streaming = true;
+        disarm(phase::write);
+        drain(x);
+    }
+    /**
+     * queues a chunk of the body of a streamed response, rejected if the stream is not the response of the exchange or has been finished
+     */
+    void push(std::shared_ptr<exchange> x, const void* chan, std::shared_ptr<const std::string> data, udho::stream::handler_type handler, bool last){
+        bool accepted = !_closing && x->_stream == chan && !x->_finished;
+        if(!accepted || (!last && (!data || data->empty()))){
+            if(handler){
+                boost::system::error_code ec = accepted ? boost::system::error_code() : boost::system::error_code(boost::asio::error::operation_aborted);
+                boost::asio::post(_strand, std::bind(handler, ec));
+            }
+            return;
+        }
+        x->_finished = last;
+        x->_pieces.push_back(piece{data, handler, last});
+        drain(x);
+    }
+    /**
+     * writes the next chunk of a streamed body once its headers have been written and the previous chunk is done.
+     * The write deadline is armed while a chunk is being written only, a stream may wait indefinitely for its next chunk e.g. server sent events.
+     */
+    void drain(std::shared_ptr<exchange> x){
+        if(!x->_streaming || x->_busy || x->_pieces.empty()){
+            return;
+        }
+        x->_busy = true;
+        expect(phase::write);
+        const piece& p = x->_pieces.front();
+        auto done = boost::asio::bind_executor(_strand, std::bind(&self_type::on_piece, std::enable_shared_from_this<connection<RouterT, AttachmentT, ProtocolT>>::shared_from_this(), x, std::placeholders::_1, std::placeholders::_2));
+        bool chunked = x->_req.version() >= 11;
+        if(x->_req.method() == http::verb::head || (p._last && !chunked)){
+            boost::asio::post(_strand, std::bind(&self_type::on_piece, std::enable_shared_from_this<connection<RouterT, AttachmentT, ProtocolT>>::shared_from_this(), x, boost::system::error_code(), 0));
+        }else if(p._last){
+            boost::asio::async_write(_socket, http::make_chunk_last(), done);
+        }else if(chunked){
+            boost::asio::async_write(_socket, http::make_chunk(boost::asio::buffer(*p._data)), done);
+        }else{
+            boost::asio::async_write(_socket, boost::asio::buffer(*p._data), done);
+        }
+    }
+    void on_piece(std::shared_ptr<exchange> x, boost::system::error_code ec, std::size_t bytes_transferred){
+        if(_closing){
+            return;
+        }
+        x->_busy = false;
+        disarm(phase::write);
+        piece p = std::move(x->_pieces.front());
+        x->_pieces.pop_front();
+        if(p._handler){
+            p._handler(ec);
+        }
+        if(ec || p._last){
+            return on_write(ec, bytes_transferred, std::static_pointer_cast<udho::stream::header_type>(x->_response)->need_eof());
+        }
+        drain(x);
+    }
+    /**
+     * upgrade of the request being routed to a websocket, through ctx.upgrade(). The socket is handed over to the websocket
+     * once the responses of the earlier requests have been written.
+     */
+    void upgrade(std::shared_ptr<exchange> x, udho::websocket::upgrade& up){
+        if(!boost::beast::websocket::is_upgrade(x->_req)){
+            throw udho::exceptions::http_error(boost::beast::http::status::upgrade_required, "the resource is available over websocket only");
+        }
+        if(!_strand.running_in_this_thread() || _reading || _waiting || _upgrading || _exchanges.empty() || _exchanges.back() != x){
+            throw udho::exceptions::http_error(boost::beast::http::status::internal_server_error, "websocket upgrade outside the routing of the upgrade request");
+        }
+        std::shared_ptr<udho::websocket::upgrade> pending = std::make_shared<udho::websocket::upgrade>(up);
+        self_type* self = this;
+        if(enqueue(x, pending, [self, x, pending](){ self->handover(x, pending); })){
+            _upgrading = true;
+        }
+    }
+    void handover(std::shared_ptr<exchange> x, std::shared_ptr<udho::websocket::upgrade> up){
+        boost::system::error_code ec;
+        _attachment << udho::logging::messages::formatted::info("router", "%1% %2% %3% upgraded to websocket") % udho::internal::peer(_socket.remote_endpoint(ec)) % x->_req.method() % x->_req.target();
+        _closing = true;
+        disarm(phase::idle);
+        disarm(phase::write);
+        discard();
+        std::make_shared<udho::websocket::session<socket_type, boost::asio::strand<boost::asio::io_context::executor_type>>>(std::move(_socket), _strand, x->_req, *up)->run();
+    }
+    /**
+     * the handler dropped the stream, a stream dropped before being finished aborts the connection
+     */
+    void abandon(std::shared_ptr<exchange> x, const void* chan){
+        if(_closing || x->_stream != chan || x->_finished){
+            return;
+        }
+        _attachment << udho::logging::messages::formatted::warning("connection", "aborting connection after the stream of %1% %2% was dropped unfinished") % x->_req.method() % x->_req.target();
+        abort();
     }
 };
 
@@ -36,6 +36,7 @@
 #include <boost/optional.hpp>
 #include <boost/beast/http/message.hpp>
 #include <boost/shared_ptr.hpp>
+#include <boost/make_shared.hpp>
 #include <boost/algorithm/string.hpp>
 #include <boost/lexical_cast.hpp>
 #include <boost/uuid/uuid.hpp>
@@ -47,6 +48,7 @@
 #include <udho/cache.h>
 #include <udho/logging.h>
 #include <udho/defs.h>
+#include <udho/headers.h>
 #include <udho/forms.h>
 #include <udho/cookie.h>
 #include <udho/session.h>
@@ -54,6 +56,8 @@
 #include <udho/compositors.h>
 #include <udho/client.h>
 #include <udho/url.h>
+#include <udho/stream.h>
+#include <udho/websocket.h>
 
 namespace udho{
 
@@ -65,6 +69,8 @@ struct interaction_{
     boost::signals2::signal<void (const udho::logging::messages::info&)>    _info;
     boost::signals2::signal<void (const udho::logging::messages::debug&)>   _debug;
     boost::signals2::signal<void (udho::defs::response_type&)>              _respond;
+    boost::signals2::signal<void (udho::stream&)>                           _stream;
+    boost::signals2::signal<void (udho::websocket::upgrade&)>               _upgrade;
     
     template <typename AuxT, typename LoggerT, typename CacheT>
     void attach(udho::attachment<AuxT, LoggerT, CacheT>& attachment){
@@ -94,6 +100,12 @@ struct interaction_{
     void respond(udho::defs::response_type& response){
         _respond(response);
     }
+    void open(udho::stream& stream){
+        _stream(stream);
+    }
+    void upgrade(udho::websocket::upgrade& up){
+        _upgrade(up);
+    }
 };
     
 /**
@@ -131,7 +143,10 @@ struct context_impl: interaction_{
     }
     template<class Body, class Fields>
     void patch(boost::beast::http::message<false, Body, Fields>& res) const{
-        res.result(_status);
+        // a status set through the context overrides the one of the response e.g. 206 or 416 of a ranged file
+        if(_status != boost::beast::http::status::ok){
+            res.result(_status);
+        }
         for(const auto& header: _headers){
             if(header.name() != boost::beast::http::field::set_cookie){
                 res.set(header.name(), header.value());
@@ -221,8 +236,11 @@ struct context_common{
     pimple_type _pimpl;
     AuxT&       _aux;
     
+    /**
+     * the context is allocated with the allocator of the request, i.e. from the arena of the connection that has read it
+     */
     template <typename C>
-    context_common(AuxT& aux, const RequestT& request, const C&): _pimpl(new impl_type(request)), _aux(aux){}
+    context_common(AuxT& aux, const RequestT& request, const C&): _pimpl(boost::allocate_shared<impl_type>(request.get_allocator(), request)), _aux(aux){}
     template <typename ShadowT>
     context_common(self_type& other): _pimpl(other._pimpl), _aux(other._aux){}
     interaction_& interaction() { return _pimpl->interaction(); }
@@ -288,7 +306,8 @@ struct context_common{
         return _aux;
     }
     /**
-     * respond with a http status. The responded output will be put inside a beast HTTP response object and a content type header of type mime will be attached
+     * respond a deferred request with a prepared response. May be called from any thread, the response is delivered on the strand of the connection.
+     * Only the first response to a request is sent, later responses are rejected.
      */
     void respond(udho::defs::response_type& response){
         _pimpl->respond(response);
@@ -310,6 +329,37 @@ struct context_common{
         status(s);
         respond<OutputT>(output, mime);
     }
+    /**
+     * respond a deferred request with a body that is streamed in chunks, the headers are sent once the earlier responses of the connection are written.
+     * The status, headers and cookies set through the context are sent along with the headers.
+     * \see udho::stream
+     */
+    udho::stream stream(const std::string& mime){
+        udho::stream::header_type header{boost::beast::http::status::ok, request().version()};
+        header.set(boost::beast::http::field::content_type, mime);
+        return stream(std::move(header));
+    }
+    /**
+     * respond a deferred request with a streamed body and headers prepared by the caller
+     */
+    udho::stream stream(udho::stream::header_type header){
+        udho::headers::stamp(header);
+        header.keep_alive(request().keep_alive());
+        patch(header);
+        udho::stream stream(std::move(header));
+        _pimpl->open(stream);
+        return stream;
+    }
+    /**
+     * hands the connection over to a websocket once the earlier responses of the connection are written.
+     * Must be called while the upgrade request is being routed e.g. through `udho::get(f).websocket()`.
+     * The headers and cookies set through the context are sent along with 101 Switching Protocols.
+     */
+    void upgrade(const udho::websocket::handlers& handlers, const udho::websocket::options& options = udho::websocket::options()){
+        udho::websocket::upgrade up{handlers, options, udho::websocket::upgrade::header_type()};
+        patch(up._header);
+        _pimpl->upgrade(up);
+    }
     /**
      * set a status code for the HTTP response
      */
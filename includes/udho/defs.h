@@ -35,6 +35,8 @@
 #include <boost/beast/http/message.hpp>
 #include <boost/beast/http/string_body.hpp>
 #include <boost/beast/version.hpp>
+#include <boost/beast/http/fields.hpp>
+#include <udho/arena.h>
 
 //  UDHO_VERSION % 100 is the patch level
 //  UDHO_VERSION / 100 % 1000 is the minor version
@@ -46,7 +48,11 @@
 namespace udho{
 namespace defs{
     
-typedef boost::beast::http::request<boost::beast::http::string_body>  request_type;
+/**
+ * header fields allocated from the arena of the connection, or from the global heap if default constructed
+ */
+typedef boost::beast::http::basic_fields<udho::arena_allocator<char>> fields_type;
+typedef boost::beast::http::request<boost::beast::http::string_body, fields_type>  request_type;
 typedef boost::beast::http::response<boost::beast::http::string_body> response_type;
 typedef boost::uuids::uuid session_key_type;
     
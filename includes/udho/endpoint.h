@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2020, Neel Basu <neel.basu.z@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <organization> nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Neel Basu <neel.basu.z@gmail.com> ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Neel Basu <neel.basu.z@gmail.com> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef UDHO_ENDPOINT_H
+#define UDHO_ENDPOINT_H
+
+#include <string>
+#include <chrono>
+#include <cstddef>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
+
+namespace udho{
+
+/**
+ * an address the server listens on, an IPv4 or IPv6 address and port or the path of a unix domain socket, with the options of its listening socket
+ * @code
+ * server.serve(router, {
+ *     udho::endpoint::tcp4(9198).nodelay().backlog(4096).accepts(16),
+ *     udho::endpoint::tcp6(9198, "::1"),
+ *     udho::endpoint::local("/run/app/http.sock", 0660)  // e.g. behind a reverse proxy on the same host
+ * });
+ * @endcode
+ * \ingroup server
+ */
+struct endpoint{
+    enum family_type{
+        ipv4,
+        ipv6,
+        unix_domain
+    };
+    
+    family_type    _family;
+    std::string    _address;      ///< ip address or path of the socket file
+    unsigned short _port;
+    int            _backlog;      ///< length of the queue of the connections not accepted yet, 0 for the maximum allowed
+    bool           _nodelay;      ///< TCP_NODELAY on the accepted connections
+    int            _defer_accept; ///< TCP_DEFER_ACCEPT seconds, 0 to accept before the request arrives
+    int            _fastopen;     ///< TCP_FASTOPEN queue length, 0 to disable
+    int            _permissions;  ///< mode of the socket file, -1 to keep the one the umask gives
+    std::size_t    _accepts;      ///< accepts kept pending on the listening socket, each with its own socket
+    
+    endpoint(family_type family, const std::string& address, unsigned short port): _family(family), _address(address), _port(port), _backlog(0), _nodelay(false), _defer_accept(0), _fastopen(0), _permissions(-1), _accepts(4){}
+    
+    /**
+     * IPv4 address and port, all interfaces by default
+     */
+    static endpoint tcp4(unsigned short port, const std::string& address = "0.0.0.0"){
+        return endpoint(ipv4, address, port);
+    }
+    /**
+     * IPv6 address and port, all interfaces by default. The socket is IPv6 only so that a tcp4 endpoint can listen on the same port.
+     */
+    static endpoint tcp6(unsigned short port, const std::string& address = "::"){
+        return endpoint(ipv6, address, port);
+    }
+    /**
+     * unix domain stream socket, a stale socket file left at the path is replaced
+     * @param permissions mode of the socket file e.g. 0660
+     */
+    static endpoint local(const std::string& path, int permissions = -1){
+        endpoint ep(unix_domain, path, 0);
+        ep._permissions = permissions;
+        return ep;
+    }
+    
+    endpoint& backlog(int length){
+        _backlog = length;
+        return *this;
+    }
+    endpoint& nodelay(bool flag = true){
+        _nodelay = flag;
+        return *this;
+    }
+    endpoint& defer_accept(std::chrono::seconds timeout){
+        _defer_accept = static_cast<int>(timeout.count());
+        return *this;
+    }
+    endpoint& fastopen(int queue){
+        _fastopen = queue;
+        return *this;
+    }
+    endpoint& permissions(int mode){
+        _permissions = mode;
+        return *this;
+    }
+    /**
+     * number of accepts kept pending on the listening socket, so that a burst of connections is accepted in one pass over the readable socket
+     */
+    endpoint& accepts(std::size_t count){
+        _accepts = count > 0 ? count : 1;
+        return *this;
+    }
+    
+    boost::asio::ip::tcp::endpoint tcp_endpoint() const{
+        return boost::asio::ip::tcp::endpoint(boost::asio::ip::make_address(_address), _port);
+    }
+    boost::asio::local::stream_protocol::endpoint local_endpoint() const{
+        return boost::asio::local::stream_protocol::endpoint(_address);
+    }
+    /**
+     * printable form for logging e.g. `0.0.0.0:9198`, `[::1]:9198` or `unix:/run/app/http.sock`
+     */
+    std::string str() const{
+        switch(_family){
+            case ipv4: return _address + ":" + std::to_string(_port);
+            case ipv6: return "[" + _address + "]:" + std::to_string(_port);
+            default:   return "unix:" + _address;
+        }
+    }
+};
+
+namespace internal{
+
+/**
+ * address of a peer for logging
+ */
+inline std::string peer(const boost::asio::ip::tcp::endpoint& endpoint){
+    return endpoint.address().to_string();
+}
+/**
+ * path of a peer connected over a unix domain socket for logging, usually unnamed
+ */
+inline std::string peer(const boost::asio::local::stream_protocol::endpoint& endpoint){
+    std::string path = endpoint.path();
+    return path.empty() ? std::string("unix") : "unix:" + path;
+}
+
+}
+
+}
+
+#endif // UDHO_ENDPOINT_H
@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2020, Neel Basu <neel.basu.z@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <organization> nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Neel Basu <neel.basu.z@gmail.com> ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Neel Basu <neel.basu.z@gmail.com> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef UDHO_HEADERS_H
+#define UDHO_HEADERS_H
+
+#include <ctime>
+#include <boost/utility/string_view.hpp>
+#include <boost/beast/http/field.hpp>
+#include <udho/defs.h>
+
+namespace udho{
+
+/**
+ * headers common to all responses, prepared once and shared by the compositors, the error pages and the static files
+ * @code
+ * udho::headers::stamp(res, "text/html");
+ * @endcode
+ * \ingroup server
+ */
+namespace headers{
+    
+    /**
+     * value of the Server header
+     */
+    inline boost::string_view server(){
+        static const boost::string_view value(UDHO_VERSION_STRING);
+        return value;
+    }
+    /**
+     * value of the Date header, the current second as an HTTP date e.g. `Sun, 06 Nov 1994 08:49:37 GMT`.
+     * Every thread keeps its own copy and formats it again only when the second changes.
+     */
+    inline boost::string_view date(){
+        struct cached{
+            std::time_t _second;
+            char        _buffer[32];
+            std::size_t _length;
+        };
+        static thread_local cached current = {-1, {}, 0};
+        std::time_t now = std::time(nullptr);
+        if(now != current._second){
+            std::tm tm;
+            gmtime_r(&now, &tm);
+            current._length = std::strftime(current._buffer, sizeof(current._buffer), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+            current._second = now;
+        }
+        return boost::string_view(current._buffer, current._length);
+    }
+    /**
+     * sets the Server and Date headers
+     */
+    template <typename MessageT>
+    void stamp(MessageT& res){
+        res.set(boost::beast::http::field::server, server());
+        res.set(boost::beast::http::field::date, date());
+    }
+    /**
+     * sets the Server, Date and Content-Type headers
+     */
+    template <typename MessageT>
+    void stamp(MessageT& res, boost::string_view mime){
+        stamp(res);
+        res.set(boost::beast::http::field::content_type, mime);
+    }
+    
+}
+
+}
+
+#endif // UDHO_HEADERS_H
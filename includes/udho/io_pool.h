@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2020, Neel Basu <neel.basu.z@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <organization> nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Neel Basu <neel.basu.z@gmail.com> ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Neel Basu <neel.basu.z@gmail.com> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef UDHO_IO_POOL_H
+#define UDHO_IO_POOL_H
+
+#include <memory>
+#include <thread>
+#include <vector>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/core/ignore_unused.hpp>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace udho{
+
+/**
+ * A pool of io_contexts, each run by exactly one thread pinned to one core.
+ * A router listening on the pool opens one SO_REUSEPORT acceptor per io_context,
+ * so that the kernel spreads the incomming connections across the cores and every
+ * connection is served by the same thread for its entire lifetime.
+ * @code
+ * udho::io_pool pool;                                           // one io_context per core
+ * udho::servers::ostreamed::stateless server(pool.context(0), std::cout);
+ * server.serve(router, pool, 9198);
+ * pool.run();                                                   // blocks until SIGINT / SIGTERM or pool.stop()
+ * @endcode
+ * \ingroup server
+ */
+class io_pool{
+    typedef boost::asio::io_context                                             context_type;
+    typedef boost::asio::executor_work_guard<context_type::executor_type>       guard_type;
+
+    std::vector<std::unique_ptr<context_type>> _contexts;
+    std::vector<guard_type>                    _guards;
+    std::vector<std::thread>                   _threads;
+    bool                                       _pinned;
+  public:
+    /**
+     * @param size number of io_contexts (and threads), defaults to the number of cores
+     * @param pinned pin the i'th thread to the i'th core
+     */
+    explicit io_pool(std::size_t size = std::thread::hardware_concurrency(), bool pinned = true): _pinned(pinned){
+        if(size == 0){
+            size = 1;
+        }
+        for(std::size_t i = 0; i < size; ++i){
+            _contexts.emplace_back(new context_type(1));
+            _guards.emplace_back(boost::asio::make_work_guard(*_contexts.back()));
+        }
+    }
+    io_pool(const io_pool&) = delete;
+    io_pool& operator=(const io_pool&) = delete;
+    ~io_pool(){
+        stop();
+        join();
+    }
+    /**
+     * number of io_contexts in the pool
+     */
+    std::size_t size() const{
+        return _contexts.size();
+    }
+    /**
+     * the i'th io_context
+     */
+    context_type& context(std::size_t i){
+        return *_contexts.at(i);
+    }
+    context_type& operator[](std::size_t i){
+        return context(i);
+    }
+    /**
+     * starts one thread per io_context and returns immediately
+     */
+    void start(){
+        if(!_threads.empty()){
+            return;
+        }
+        for(std::size_t i = 0; i < _contexts.size(); ++i){
+            context_type* ctx = _contexts[i].get();
+            _threads.emplace_back([ctx](){
+                ctx->run();
+            });
+            if(_pinned){
+                pin(_threads.back(), i);
+            }
+        }
+    }
+    /**
+     * starts all threads and blocks until all of them have finished
+     */
+    void run(){
+        start();
+        join();
+    }
+    /**
+     * stops all io_contexts. The threads finish after completing the handler they are running.
+     */
+    void stop(){
+        _guards.clear();
+        for(auto& ctx: _contexts){
+            ctx->stop();
+        }
+    }
+    /**
+     * waits for all threads to finish
+     */
+    void join(){
+        for(std::thread& thread: _threads){
+            if(!thread.joinable()){
+                continue;
+            }
+            if(thread.get_id() == std::this_thread::get_id()){
+                thread.detach();
+            }else{
+                thread.join();
+            }
+        }
+        _threads.clear();
+    }
+  private:
+    static void pin(std::thread& thread, std::size_t index){
+#ifdef __linux__
+        unsigned cores = std::thread::hardware_concurrency();
+        if(cores == 0){
+            return;
+        }
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        CPU_SET(index % cores, &cpuset);
+        pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set_t), &cpuset);
+#else
+        boost::ignore_unused(thread, index);
+#endif
+    }
+};
+
+}
+
+#endif // UDHO_IO_POOL_H
@@ -6,53 +6,200 @@
 #include <boost/format.hpp>
 #include <boost/enable_shared_from_this.hpp>
 #include <udho/configuration.h>
+#include <udho/registry.h>
+#include <udho/endpoint.h>
+#include <udho/io_pool.h>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 
 namespace udho{
 
+#ifdef SO_REUSEPORT
+typedef boost::asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT> reuse_port;
+#endif
+
+namespace internal{
+
+/**
+ * protocol specific setup of the listening socket
+ */
+template <typename ProtocolT>
+struct listening;
+
+template <>
+struct listening<boost::asio::ip::tcp>{
+    typedef boost::asio::ip::tcp::endpoint endpoint_type;
+    
+    static endpoint_type resolve(const udho::endpoint& options){
+        return options.tcp_endpoint();
+    }
+    /**
+     * SO_REUSEADDR, SO_REUSEPORT if shared and IPV6_V6ONLY for IPv6 so that an IPv4 endpoint can listen on the same port
+     */
+    template <typename AcceptorT>
+    static void prepare(AcceptorT& acceptor, const endpoint_type& endpoint, const udho::endpoint& /*options*/, bool shared){
+        boost::system::error_code ec;
+        acceptor.set_option(boost::asio::socket_base::reuse_address(true), ec);
+        if(ec) throw std::runtime_error((boost::format("Failed to set reusable option %1%") % ec.message()).str());
+        if(shared){
+#ifdef SO_REUSEPORT
+            acceptor.set_option(udho::reuse_port(true), ec);
+            if(ec) throw std::runtime_error((boost::format("Failed to set reuse port option %1%") % ec.message()).str());
+#else
+            throw std::runtime_error("SO_REUSEPORT is not supported on this platform");
+#endif
+        }
+        if(endpoint.address().is_v6()){
+            acceptor.set_option(boost::asio::ip::v6_only(true), ec);
+            if(ec) throw std::runtime_error((boost::format("Failed to set IPv6 only option %1%") % ec.message()).str());
+        }
+    }
+    /**
+     * TCP_DEFER_ACCEPT and TCP_FASTOPEN where the platform has them
+     */
+    template <typename AcceptorT>
+    static void bound(AcceptorT& acceptor, const udho::endpoint& options){
+        if(options._defer_accept > 0){
+#ifdef TCP_DEFER_ACCEPT
+            int seconds = options._defer_accept;
+            if(::setsockopt(acceptor.native_handle(), IPPROTO_TCP, TCP_DEFER_ACCEPT, &seconds, sizeof(seconds)) != 0) throw std::runtime_error((boost::format("Failed to set TCP_DEFER_ACCEPT %1%") % std::strerror(errno)).str());
+#else
+            throw std::runtime_error("TCP_DEFER_ACCEPT is not supported on this platform");
+#endif
+        }
+        if(options._fastopen > 0){
+#ifdef TCP_FASTOPEN
+            int queue = options._fastopen;
+            if(::setsockopt(acceptor.native_handle(), IPPROTO_TCP, TCP_FASTOPEN, &queue, sizeof(queue)) != 0) throw std::runtime_error((boost::format("Failed to set TCP_FASTOPEN %1%") % std::strerror(errno)).str());
+#else
+            throw std::runtime_error("TCP_FASTOPEN is not supported on this platform");
+#endif
+        }
+    }
+    template <typename SocketT>
+    static void accepted(SocketT& socket, const udho::endpoint& options){
+        if(options._nodelay){
+            boost::system::error_code ec;
+            socket.set_option(boost::asio::ip::tcp::no_delay(true), ec);
+        }
+    }
+    static void release(const udho::endpoint& /*options*/){}
+};
+
+template <>
+struct listening<boost::asio::local::stream_protocol>{
+    typedef boost::asio::local::stream_protocol::endpoint endpoint_type;
+    
+    static endpoint_type resolve(const udho::endpoint& options){
+        return options.local_endpoint();
+    }
+    /**
+     * removes the socket file left by an earlier run, refuses to replace any other kind of file
+     */
+    template <typename AcceptorT>
+    static void prepare(AcceptorT& /*acceptor*/, const endpoint_type& endpoint, const udho::endpoint& /*options*/, bool shared){
+        if(shared){
+            throw std::runtime_error("unix domain sockets cannot be shared by multiple listeners");
+        }
+        struct stat info;
+        if(::lstat(endpoint.path().c_str(), &info) == 0){
+            if(!S_ISSOCK(info.st_mode)){
+                throw std::runtime_error((boost::format("Failed to bind %1% that exists and is not a socket") % endpoint.path()).str());
+            }
+            ::unlink(endpoint.path().c_str());
+        }
+    }
+    /**
+     * sets the permissions of the socket file
+     */
+    template <typename AcceptorT>
+    static void bound(AcceptorT& /*acceptor*/, const udho::endpoint& options){
+        if(options._permissions >= 0 && ::chmod(options._address.c_str(), static_cast<mode_t>(options._permissions)) != 0){
+            throw std::runtime_error((boost::format("Failed to set permissions of %1% %2%") % options._address % std::strerror(errno)).str());
+        }
+    }
+    template <typename SocketT>
+    static void accepted(SocketT& /*socket*/, const udho::endpoint& /*options*/){}
+    /**
+     * removes the socket file
+     */
+    static void release(const udho::endpoint& options){
+        ::unlink(options._address.c_str());
+    }
+};
+
+}
+
 /**
  * listener runs accept loop for HTTP sockets
+ * @tparam ProtocolT stream protocol, `boost::asio::ip::tcp` or `boost::asio::local::stream_protocol` for unix domain sockets
  * \ingroup server
  */
-template <typename RouterT, typename AttachmentT>
-class listener : public std::enable_shared_from_this<listener<RouterT, AttachmentT>>{
+template <typename RouterT, typename AttachmentT, typename ProtocolT = boost::asio::ip::tcp>
+class listener : public std::enable_shared_from_this<listener<RouterT, AttachmentT, ProtocolT>>{
 #if (BOOST_VERSION / 1000 >=1 && BOOST_VERSION / 100 % 1000 >= 70)
-    typedef boost::asio::basic_stream_socket<boost::asio::ip::tcp, boost::asio::io_context::executor_type> socket_type;
+    typedef boost::asio::basic_stream_socket<ProtocolT, boost::asio::io_context::executor_type> socket_type;
 #else
-    typedef boost::asio::basic_stream_socket<boost::asio::ip::tcp> socket_type;
+    typedef boost::asio::basic_stream_socket<ProtocolT> socket_type;
 #endif 
 
     
-    typedef listener<RouterT, AttachmentT> self_type;
+    typedef listener<RouterT, AttachmentT, ProtocolT> self_type;
     typedef AttachmentT attachment_type;
-    typedef connection<RouterT, AttachmentT> connection_type;
+    typedef connection<RouterT, AttachmentT, ProtocolT> connection_type;
+    typedef internal::listening<ProtocolT> listening_type;
     
     boost::asio::io_service& _service;
-    boost::asio::ip::tcp::acceptor _acceptor;
-    socket_type _socket;
+    typename ProtocolT::acceptor _acceptor;
+    std::vector<socket_type> _sockets; ///< one socket per pending accept
+    std::vector<std::size_t> _parked;  ///< pending accepts withheld while accepting is paused
     boost::asio::signal_set _signals;
     RouterT& _router;
     attachment_type& _attachment;
-  public:
-    /**
-     * @param router HTTP url mapping router
-     * @param service I/O service
-     * @param endpoint HTTP server endpoint to listen on
-     */
-    listener(RouterT& router, boost::asio::io_service& service, attachment_type& attachment, const boost::asio::ip::tcp::endpoint& endpoint): _service(service), _acceptor(service), _socket(service), _signals(service, SIGINT, SIGTERM), _router(router), _attachment(attachment){
+    boost::asio::steady_timer _timer;   ///< polls the live connections while draining
+    boost::asio::steady_timer _pause;   ///< polls the live connections while accepting is paused
+    std::chrono::steady_clock::time_point _deadline;
+    bool _draining;
+    bool _paused;
+    udho::registry::membership _membership;
+    udho::endpoint _options;
+    
+    listener(RouterT& router, boost::asio::io_service& service, attachment_type& attachment, const typename ProtocolT::endpoint& endpoint, const udho::endpoint& options, bool shared): _service(service), _acceptor(service), _signals(service, SIGINT, SIGTERM), _router(router), _attachment(attachment), _timer(service), _pause(service), _draining(false), _paused(false), _options(options){
         boost::system::error_code ec;
         _acceptor.open(endpoint.protocol(), ec);
         if(ec) throw std::runtime_error((boost::format("Failed to open acceptor %1%") % ec.message()).str());
-        _acceptor.set_option(boost::asio::socket_base::reuse_address(true), ec);
-        if(ec) throw std::runtime_error((boost::format("Failed to set reusable option %1%") % ec.message()).str());
+        listening_type::prepare(_acceptor, endpoint, options, shared);
         _acceptor.bind(endpoint, ec);
         if(ec) throw std::runtime_error((boost::format("Failed to bind acceptor %1%") % ec.message()).str());
-        _acceptor.listen(boost::asio::socket_base::max_listen_connections, ec);
+        listening_type::bound(_acceptor, options);
+        _acceptor.listen(options._backlog > 0 ? options._backlog : static_cast<int>(boost::asio::socket_base::max_listen_connections), ec);
         if(ec) throw std::runtime_error((boost::format("Failed to listen %1%") % ec.message()).str());
-        
-        _signals.async_wait(boost::bind(&self_type::stop, this));
+        _sockets.reserve(options._accepts);
+        for(std::size_t i = 0; i < std::max<std::size_t>(options._accepts, 1); ++i){
+            _sockets.emplace_back(service);
+        }
     }
+  public:
     /**
-     * stops accepting incomming connections
+     * @param router HTTP url mapping router
+     * @param service I/O service
+     * @param endpoint HTTP server endpoint to listen on
+     * @param shared set SO_REUSEPORT so that multiple listeners (one per io_context) can bind the same endpoint
+     */
+    listener(RouterT& router, boost::asio::io_service& service, attachment_type& attachment, const typename ProtocolT::endpoint& endpoint, bool shared = false): listener(router, service, attachment, endpoint, udho::endpoint(udho::endpoint::ipv4, std::string(), 0), shared){}
+    /**
+     * @param options endpoint to listen on with the options of the listening socket
+     */
+    listener(RouterT& router, boost::asio::io_service& service, attachment_type& attachment, const udho::endpoint& options, bool shared = false): listener(router, service, attachment, listening_type::resolve(options), options, shared){}
+    /**
+     * stops accepting incomming connections and stops the io_context without waiting for the in-flight requests
      */
     void stop(){
         _acceptor.close();
@@ -60,6 +207,9 @@ class listener : public std::enable_shared_from_this<listener<RouterT, Attachmen
     }
     ~listener(){
         stop();
+        if(!_options._address.empty()){
+            listening_type::release(_options);
+        }
     }
     /**
      * starts the async accept loop
@@ -67,27 +217,151 @@ class listener : public std::enable_shared_from_this<listener<RouterT, Attachmen
     void run(){
         if(! _acceptor.is_open())
             return;
-        accept();
+        std::weak_ptr<self_type> weak = std::enable_shared_from_this<listener<RouterT, AttachmentT, ProtocolT>>::shared_from_this();
+        _membership = _attachment.aux().connections().watch([weak](){
+            std::shared_ptr<self_type> self = weak.lock();
+            if(self){
+                boost::asio::post(self->_service, std::bind(&self_type::drain, self));
+            }
+        });
+        _signals.async_wait(std::bind(&self_type::on_signal, std::enable_shared_from_this<listener<RouterT, AttachmentT, ProtocolT>>::shared_from_this(), std::placeholders::_1, std::placeholders::_2));
+        for(std::size_t slot = 0; slot < _sockets.size(); ++slot){
+            accept(slot);
+        }
     }
     /**
-     * accept an incomming connection
+     * SIGINT or SIGTERM drains all the listeners and connections of the server
      */
-    void accept(){
-        _acceptor.async_accept(_socket, std::bind(&self_type::on_accept, std::enable_shared_from_this<listener<RouterT, AttachmentT>>::shared_from_this(), std::placeholders::_1));
-    }
-    void on_accept(boost::system::error_code ec){
+    void on_signal(boost::system::error_code ec, int signal){
         if(ec){
-            // TODO failed to accept
-            _attachment << udho::logging::messages::formatted::info("listener", "failed to accept new connection from %1%") % _socket.remote_endpoint().address();
+            return;
+        }
+        _attachment << udho::logging::messages::formatted::info("listener", "received signal %1%, draining %2% connections") % signal % _attachment.aux().connections().live();
+        _attachment.aux().connections().drain();
+    }
+    /**
+     * stops accepting incomming connections and stops the io_context once the live connections have closed or `udho::configs::timeouts::drain` has passed
+     */
+    void drain(){
+        if(_draining){
+            return;
+        }
+        _draining = true;
+        boost::system::error_code ec;
+        _acceptor.close(ec);
+        _signals.cancel(ec);
+        _pause.cancel();
+        const udho::configs::timeouts& timeouts = _attachment.aux().config();
+        _deadline = std::chrono::steady_clock::now() + timeouts.get(udho::configs::timeouts::drain);
+        wait();
+    }
+    void wait(){
+        _timer.expires_after(std::chrono::milliseconds(10));
+        _timer.async_wait(std::bind(&self_type::on_wait, std::enable_shared_from_this<listener<RouterT, AttachmentT, ProtocolT>>::shared_from_this(), std::placeholders::_1));
+    }
+    void on_wait(boost::system::error_code ec){
+        if(ec == boost::asio::error::operation_aborted){
+            return;
+        }
+        std::size_t live = _attachment.aux().connections().live();
+        if(live == 0){
+            _attachment << udho::logging::messages::formatted::info("listener", "stopping after draining all connections");
+        }else if(std::chrono::steady_clock::now() >= _deadline){
+            _attachment << udho::logging::messages::formatted::warning("listener", "stopping with %1% connections still open after the drain deadline") % live;
         }else{
-            _attachment << udho::logging::messages::formatted::info("listener", "accepting new connection from %1%") % _socket.remote_endpoint().address();
-            std::shared_ptr<connection_type> conn = std::make_shared<connection<RouterT, AttachmentT>>(_router, _attachment, std::move(_socket));
-            conn->run();
+            return wait();
+        }
+        _service.stop();
+    }
+    /**
+     * keeps an accept pending on the socket of the slot, unless `udho::configs::admission::connections` connections are open.
+     * Then accepting pauses until some of them close, leaving the new connections in the backlog of the kernel.
+     */
+    void accept(std::size_t slot){
+        const udho::configs::admission& admission = _attachment.aux().config();
+        std::size_t limit = admission.get(udho::configs::admission::connections);
+        if(limit && _attachment.aux().connections().live() >= limit){
+            _parked.push_back(slot);
+            if(!_paused){
+                _paused = true;
+                _attachment.aux().metrics().increment(udho::metrics::paused_accepts);
+                _attachment << udho::logging::messages::formatted::warning("listener", "pausing accept with %1% connections open") % limit;
+                pause();
+            }
+            return;
+        }
+        _acceptor.async_accept(_sockets[slot], std::bind(&self_type::on_accept, std::enable_shared_from_this<listener<RouterT, AttachmentT, ProtocolT>>::shared_from_this(), slot, std::placeholders::_1));
+    }
+    void pause(){
+        _pause.expires_after(std::chrono::milliseconds(5));
+        _pause.async_wait(std::bind(&self_type::on_pause, std::enable_shared_from_this<listener<RouterT, AttachmentT, ProtocolT>>::shared_from_this(), std::placeholders::_1));
+    }
+    void on_pause(boost::system::error_code ec){
+        if(ec == boost::asio::error::operation_aborted || !_acceptor.is_open()){
+            return;
+        }
+        const udho::configs::admission& admission = _attachment.aux().config();
+        std::size_t limit = admission.get(udho::configs::admission::connections);
+        if(limit && _attachment.aux().connections().live() >= limit){
+            return pause();
+        }
+        _paused = false;
+        _attachment << udho::logging::messages::formatted::info("listener", "resuming accept");
+        std::vector<std::size_t> parked;
+        parked.swap(_parked);
+        for(std::size_t slot: parked){
+            accept(slot);
         }
-        accept();
+    }
+    /**
+     * takes the accepted socket out of its slot and re-arms the accept of the slot before the connection is set up
+     */
+    void on_accept(std::size_t slot, boost::system::error_code ec){
+        if(ec){
+            if(ec == boost::asio::error::operation_aborted || !_acceptor.is_open()){
+                return;
+            }
+            _attachment << udho::logging::messages::formatted::info("listener", "failed to accept new connection %1%") % ec.message();
+            return accept(slot);
+        }
+        socket_type socket(std::move(_sockets[slot]));
+        accept(slot);
+        boost::system::error_code err;
+        _attachment << udho::logging::messages::formatted::info("listener", "accepting new connection from %1%") % udho::internal::peer(socket.remote_endpoint(err));
+        listening_type::accepted(socket, _options);
+        std::shared_ptr<connection_type> conn = std::make_shared<connection_type>(_router, _attachment, std::move(socket));
+        conn->run();
     }
 };
 
+/**
+ * listens on the endpoint, with a tcp or a unix domain socket listener depending on its family
+ * \ingroup server
+ */
+template <typename RouterT, typename AttachmentT>
+void listen(RouterT& router, boost::asio::io_service& io, AttachmentT& attachment, const udho::endpoint& endpoint, bool shared = false){
+    if(endpoint._family == udho::endpoint::unix_domain){
+        std::make_shared<udho::listener<RouterT, AttachmentT, boost::asio::local::stream_protocol>>(router, io, attachment, endpoint, shared)->run();
+    }else{
+        std::make_shared<udho::listener<RouterT, AttachmentT, boost::asio::ip::tcp>>(router, io, attachment, endpoint, shared)->run();
+    }
+}
+
+/**
+ * listens on every io_context of the pool with one SO_REUSEPORT acceptor per io_context.
+ * A unix domain socket cannot be shared that way and is accepted on the first io_context only.
+ * \ingroup server
+ */
+template <typename RouterT, typename AttachmentT>
+void listen(RouterT& router, udho::io_pool& pool, AttachmentT& attachment, const udho::endpoint& endpoint){
+    if(endpoint._family == udho::endpoint::unix_domain){
+        return listen(router, pool.context(0), attachment, endpoint);
+    }
+    for(std::size_t i = 0; i < pool.size(); ++i){
+        listen(router, pool.context(i), attachment, endpoint, pool.size() > 1);
+    }
+}
+
 }
 
 #endif // UDHO_LISTENER_H
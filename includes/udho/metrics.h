@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2020, Neel Basu <neel.basu.z@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <organization> nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Neel Basu <neel.basu.z@gmail.com> ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Neel Basu <neel.basu.z@gmail.com> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef UDHO_METRICS_H
+#define UDHO_METRICS_H
+
+#include <map>
+#include <atomic>
+#include <string>
+#include <cstdint>
+
+namespace udho{
+
+/**
+ * counters of the events of the server, shared by all connections and safe to update from all threads of an io_pool.
+ * @code
+ * server._attachment.aux().metrics()[udho::metrics::idle_timeouts];
+ * @endcode
+ * \ingroup server
+ */
+class metrics{
+  public:
+    enum counter{
+        idle_timeouts,    ///< keep-alive connections closed after waiting too long for the next request
+        header_timeouts,  ///< connections closed while receiving the request line and headers
+        body_timeouts,    ///< connections closed while receiving the request body
+        write_timeouts,   ///< connections closed while sending the response
+        rejected_responses, ///< responses discarded because the request has already been responded or its connection is closed
+        paused_accepts,   ///< times accepting paused because udho::configs::admission::connections connections were open
+        shed_requests,    ///< requests answered with 503 Service Unavailable because the server is overloaded
+        counters          ///< number of counters
+    };
+  private:
+    std::atomic<std::uint64_t> _counters[counters];
+  public:
+    metrics(){
+        for(std::atomic<std::uint64_t>& c: _counters){
+            c.store(0, std::memory_order_relaxed);
+        }
+    }
+    metrics(const metrics&) = delete;
+    metrics& operator=(const metrics&) = delete;
+    void increment(counter c, std::uint64_t by = 1){
+        _counters[c].fetch_add(by, std::memory_order_relaxed);
+    }
+    std::uint64_t operator[](counter c) const{
+        return _counters[c].load(std::memory_order_relaxed);
+    }
+    static const char* name(counter c){
+        static const char* names[] = {"idle_timeouts", "header_timeouts", "body_timeouts", "write_timeouts", "rejected_responses", "paused_accepts", "shed_requests"};
+        return names[c];
+    }
+    /**
+     * current values of all counters by name
+     */
+    std::map<std::string, std::uint64_t> snapshot() const{
+        std::map<std::string, std::uint64_t> values;
+        for(int c = 0; c < counters; ++c){
+            values[name(static_cast<counter>(c))] = operator[](static_cast<counter>(c));
+        }
+        return values;
+    }
+};
+
+}
+
+#endif // UDHO_METRICS_H
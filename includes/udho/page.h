@@ -7,6 +7,7 @@
 #include <boost/beast/http.hpp>
 #include <boost/beast/version.hpp>
 #include <udho/context.h>
+#include <udho/headers.h>
 #include <iostream>
 #include <udho/visitor.h>
 
@@ -38,14 +39,13 @@ namespace exceptions{
         http_error(boost::beast::http::status status, const std::string& message = "");
         void add_header(boost::beast::http::field key, const std::string& value);
         void redirect(const std::string& url);
-        template <typename T>
-        boost::beast::http::response<boost::beast::http::string_body> response(const boost::beast::http::request<T>& request) const{
+        template <typename T, typename F>
+        boost::beast::http::response<boost::beast::http::string_body> response(const boost::beast::http::request<T, F>& request) const{
             boost::beast::http::response<boost::beast::http::string_body> res{_status, request.version()};
             for(const auto& header: _headers){
                 res.set(header.name(), header.value());
             }
-            res.set(boost::beast::http::field::server, UDHO_VERSION_STRING);
-            res.set(boost::beast::http::field::content_type, "text/html");
+            udho::headers::stamp(res, "text/html");
             res.keep_alive(request.keep_alive());
             res.body() = page(request.target().to_string());
             res.prepare_payload();
@@ -55,14 +55,13 @@ namespace exceptions{
         boost::beast::http::response<boost::beast::http::string_body> response(const udho::context<AuxT, U, V>& ctx) const{
             return response(ctx.request());
         }
-        template <typename T, typename RouterT>
-        boost::beast::http::response<boost::beast::http::string_body> response(const boost::beast::http::request<T>& request, RouterT& router) const{
+        template <typename T, typename F, typename RouterT>
+        boost::beast::http::response<boost::beast::http::string_body> response(const boost::beast::http::request<T, F>& request, RouterT& router) const{
             boost::beast::http::response<boost::beast::http::string_body> res{_status, request.version()};
             for(const auto& header: _headers){
                 res.set(header.name(), header.value());
             }
-            res.set(boost::beast::http::field::server, UDHO_VERSION_STRING);
-            res.set(boost::beast::http::field::content_type, "text/html");
+            udho::headers::stamp(res, "text/html");
             res.keep_alive(request.keep_alive());
             res.body() = page(request.target().to_string(), router);
             res.prepare_payload();
@@ -0,0 +1,423 @@
+/*
+ * Copyright (c) 2020, Neel Basu <neel.basu.z@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <organization> nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Neel Basu <neel.basu.z@gmail.com> ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Neel Basu <neel.basu.z@gmail.com> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef UDHO_RADIX_H
+#define UDHO_RADIX_H
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <udho/router.h>
+#include <udho/util.h>
+
+namespace udho{
+
+namespace internal{
+namespace radix{
+
+    /**
+     * kind of a segment of an url pattern that can be stored in the radix tree
+     */
+    enum class segment{
+        literal,    ///< literal text
+        integer,    ///< `(\d+)` or `{int}`
+        string,     ///< `([^/]+)` or `{string}`
+        word,       ///< `(\w+)`
+        rest,       ///< `(.*)` trailing wildcard
+        rest_plus   ///< `(.+)` non empty trailing wildcard
+    };
+
+    struct token{
+        segment     _type;
+        std::string _literal;
+    };
+
+    /**
+     * whether the character belongs to the character class captured by the segment
+     */
+    inline bool accepts(segment type, char c){
+        unsigned char u = static_cast<unsigned char>(c);
+        switch(type){
+            case segment::integer:
+                return u >= '0' && u <= '9';
+            case segment::string:
+                return u != '/';
+            case segment::word:
+#ifdef WITH_ICU
+                return std::isalnum(u) || u == '_' || u >= 0x80;
+#else
+                return std::isalnum(u) || u == '_';
+#endif
+            default:
+                return true;
+        }
+    }
+
+    /**
+     * splits an url pattern into segments. Only anchored patterns (starting with `^`) consisting of literal text,
+     * the captures `(\d+)`, `([0-9]+)`, `([^/]+)`, `(\w+)` and a trailing `(.*)` or `(.+)` are expressible in the tree.
+     * A pattern without a trailing `$` is a prefix match (trailing wildcard without capture).
+     *
+     * @return false if the pattern cannot be expressed in the radix tree
+     */
+    inline bool tokenize(const std::string& pattern, std::vector<token>& tokens, bool& anchored){
+        static const std::vector<std::pair<std::string, segment>> captures = {
+            {"(\\d+)",   segment::integer},
+            {"([0-9]+)", segment::integer},
+            {"([^/]+)",  segment::string},
+            {"(\\w+)",   segment::word},
+            {"(.*)",     segment::rest},
+            {"(.+)",     segment::rest_plus}
+        };
+        static const std::string escapable = ".^$|()[]{}*+?\\/-";
+
+        tokens.clear();
+        anchored = false;
+        if(pattern.empty() || pattern.front() != '^'){
+            return false;
+        }
+        std::size_t i = 1;
+        while(i < pattern.size()){
+            char c = pattern[i];
+            if(c == '$'){
+                if(i != pattern.size()-1){
+                    return false;
+                }
+                anchored = true;
+                ++i;
+            }else if(c == '('){
+                auto it = std::find_if(captures.begin(), captures.end(), [&pattern, i](const std::pair<std::string, segment>& capture){
+                    return pattern.compare(i, capture.first.size(), capture.first) == 0;
+                });
+                if(it == captures.end()){
+                    return false;
+                }
+                tokens.push_back(token{it->second, ""});
+                i += it->first.size();
+            }else if(c == '\\'){
+                if(i+1 >= pattern.size() || escapable.find(pattern[i+1]) == std::string::npos){
+                    return false;
+                }
+                if(tokens.empty() || tokens.back()._type != segment::literal){
+                    tokens.push_back(token{segment::literal, ""});
+                }
+                tokens.back()._literal.push_back(pattern[i+1]);
+                i += 2;
+            }else if(std::string(".^|)[]{}*+?").find(c) != std::string::npos){
+                return false;
+            }else{
+                if(tokens.empty() || tokens.back()._type != segment::literal){
+                    tokens.push_back(token{segment::literal, ""});
+                }
+                tokens.back()._literal.push_back(c);
+                ++i;
+            }
+        }
+        // greedy captures are only expressible if the text following them cannot be captured by them
+        for(std::size_t j = 0; j < tokens.size(); ++j){
+            segment type = tokens[j]._type;
+            if(type == segment::rest || type == segment::rest_plus){
+                if(j != tokens.size()-1){
+                    return false;
+                }
+            }else if(type != segment::literal && j+1 < tokens.size()){
+                const token& next = tokens[j+1];
+                if(next._type != segment::literal || accepts(type, next._literal.front())){
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    /**
+     * node of the compressed radix tree. Each leaf stores the position of the overload in the overload chain.
+     * Position 0 means no overload.
+     */
+    struct node{
+        typedef std::pair<std::size_t, std::size_t> span_type;
+        typedef std::vector<span_type>              spans_type;
+
+        std::string                                 _label;
+        std::map<char, std::unique_ptr<node>>       _literals;
+        std::unique_ptr<node>                       _integer;
+        std::unique_ptr<node>                       _string;
+        std::unique_ptr<node>                       _word;
+        std::size_t                                 _exact;
+        std::size_t                                 _prefix;
+        std::size_t                                 _rest;
+        std::size_t                                 _rest_plus;
+
+        explicit node(const std::string& label = ""): _label(label), _exact(0), _prefix(0), _rest(0), _rest_plus(0){}
+
+        /**
+         * inserts the tokens of a pattern tagged with the position of the overload
+         */
+        void insert(std::vector<token>::const_iterator begin, std::vector<token>::const_iterator end, bool anchored, std::size_t index){
+            if(begin == end){
+                std::size_t& leaf = anchored ? _exact : _prefix;
+                leaf = std::max(leaf, index);
+                return;
+            }
+            switch(begin->_type){
+                case segment::literal:
+                    literal(begin->_literal)->insert(begin+1, end, anchored, index);
+                    break;
+                case segment::integer:
+                    child(_integer)->insert(begin+1, end, anchored, index);
+                    break;
+                case segment::string:
+                    child(_string)->insert(begin+1, end, anchored, index);
+                    break;
+                case segment::word:
+                    child(_word)->insert(begin+1, end, anchored, index);
+                    break;
+                case segment::rest:
+                    _rest = std::max(_rest, index);
+                    break;
+                case segment::rest_plus:
+                    _rest_plus = std::max(_rest_plus, index);
+                    break;
+            }
+        }
+        /**
+         * finds the matching overload with the highest position for the subject starting at pos
+         *
+         * @param best position of the best match found so far
+         * @param captures spans of the captures in the current path of the tree
+         * @param best_captures spans of the captures of the best match
+         */
+        void match(const std::string& subject, std::size_t pos, std::size_t& best, spans_type& captures, spans_type& best_captures) const{
+            if(_prefix > best){
+                best = _prefix;
+                best_captures = captures;
+            }
+            if(_rest > best){
+                best = _rest;
+                best_captures = captures;
+                best_captures.push_back(span_type(pos, subject.size() - pos));
+            }
+            if(_rest_plus > best && pos < subject.size()){
+                best = _rest_plus;
+                best_captures = captures;
+                best_captures.push_back(span_type(pos, subject.size() - pos));
+            }
+            if(pos == subject.size()){
+                if(_exact > best){
+                    best = _exact;
+                    best_captures = captures;
+                }
+                return;
+            }
+            auto it = _literals.find(subject[pos]);
+            if(it != _literals.end()){
+                const node& next = *it->second;
+                if(subject.compare(pos, next._label.size(), next._label) == 0){
+                    next.match(subject, pos + next._label.size(), best, captures, best_captures);
+                }
+            }
+            capture(_integer, segment::integer, subject, pos, best, captures, best_captures);
+            capture(_string,  segment::string,  subject, pos, best, captures, best_captures);
+            capture(_word,    segment::word,    subject, pos, best, captures, best_captures);
+        }
+      private:
+        node* child(std::unique_ptr<node>& ptr){
+            if(!ptr){
+                ptr.reset(new node);
+            }
+            return ptr.get();
+        }
+        node* literal(const std::string& text){
+            if(text.empty()){
+                return this;
+            }
+            auto it = _literals.find(text.front());
+            if(it == _literals.end()){
+                node* created = new node(text);
+                _literals[text.front()].reset(created);
+                return created;
+            }
+            node* existing = it->second.get();
+            std::size_t common = 0;
+            while(common < text.size() && common < existing->_label.size() && text[common] == existing->_label[common]){
+                ++common;
+            }
+            if(common == existing->_label.size()){
+                return existing->literal(text.substr(common));
+            }
+            // split the edge at the common prefix
+            std::unique_ptr<node> tail = std::move(it->second);
+            std::unique_ptr<node> split(new node(text.substr(0, common)));
+            tail->_label = tail->_label.substr(common);
+            split->_literals[tail->_label.front()] = std::move(tail);
+            node* splitted = split.get();
+            it->second = std::move(split);
+            return splitted->literal(text.substr(common));
+        }
+        void capture(const std::unique_ptr<node>& ptr, segment type, const std::string& subject, std::size_t pos, std::size_t& best, spans_type& captures, spans_type& best_captures) const{
+            if(!ptr){
+                return;
+            }
+            std::size_t end = pos;
+            while(end < subject.size() && accepts(type, subject[end])){
+                ++end;
+            }
+            if(end == pos){
+                return;
+            }
+            captures.push_back(span_type(pos, end - pos));
+            ptr->match(subject, end, best, captures, best_captures);
+            captures.pop_back();
+        }
+    };
+}
+}
+
+/**
+ * router that indexes the url mappings of an overload chain in a compressed radix tree per HTTP method.
+ * Dispatching a request costs O(length of the path) regardless of the number of url mappings.
+ * Patterns that the tree cannot express and mounted applications are matched with their regex as usual.
+ * Precedence is the same as of the overload chain, i.e. the url mapping attached last wins.
+ *
+ * @code
+ * auto router = udho::radix(udho::router()
+ *      | (udho::get(&add).plain()    = "^/add/{int}/{int}$")
+ *      | (udho::get(&hello).plain()  = "^/hello/([^/]+)$")
+ *      | (udho::get(&assets).raw()   = "^/assets/(.*)$")
+ *      | (udho::get(&legacy).plain() = "^/legacy/(\\d{4})$"));   // not expressible, uses regex
+ * @endcode
+ * @tparam GroupT the overload chain
+ * @ingroup routing
+ */
+template <typename GroupT>
+struct radix_router: GroupT{
+    typedef GroupT                          group_type;
+    typedef radix_router<GroupT>            self_type;
+    typedef internal::radix::node           node_type;
+    typedef typename node_type::spans_type  spans_type;
+    typedef std::vector<boost::string_view> captures_type;
+
+    std::map<boost::beast::http::verb, std::shared_ptr<const node_type>> _trees;
+    internal::verb_index                                                   _fallbacks;
+
+    explicit radix_router(const group_type& group): group_type(group){
+        std::map<boost::beast::http::verb, std::shared_ptr<node_type>> trees;
+        std::vector<std::pair<module_info, bool>> descriptions = internal::describe_overloads(static_cast<const group_type&>(*this));
+        for(std::size_t i = descriptions.size()-1; i > 0; --i){
+            const module_info& info = descriptions[i].first;
+            if(!descriptions[i].second){
+                _fallbacks.add(i, info, false);
+                continue;
+            }
+            std::vector<internal::radix::token> tokens;
+            bool anchored = false;
+            if(internal::radix::tokenize(info._pattern, tokens, anchored)){
+                std::shared_ptr<node_type>& root = trees[info._method];
+                if(!root){
+                    root = std::make_shared<node_type>();
+                }
+                root->insert(tokens.cbegin(), tokens.cend(), anchored, i);
+            }else if(!info._pattern.empty()){
+                _fallbacks.add(i, info, true);
+            }
+        }
+        _fallbacks.seal();
+        for(auto& tree: trees){
+            _trees[tree.first] = tree.second;
+        }
+    }
+    /**
+     * serves the request with the url mapping of highest precedence found in the radix tree or among the patterns that are not expressible in the tree.
+     */
+    template <typename ContextT, typename Lambda>
+    int serve(ContextT& ctx, boost::beast::http::verb request_method, const std::string& subject, Lambda send){
+        typedef internal::group_dispatcher<group_type, ContextT, Lambda, captures_type> dispatcher_type;
+
+        group_type& group = static_cast<group_type&>(*this);
+        std::string subject_decoded = udho::util::urldecode(subject);
+        std::size_t best = 0;
+        spans_type captures, best_captures;
+        auto tree = _trees.find(request_method);
+        if(tree != _trees.end()){
+            tree->second->match(subject_decoded, 0, best, captures, best_captures);
+        }
+
+        for(std::size_t index: _fallbacks.candidates(request_method)){
+            if(index < best){
+                break;
+            }
+            int status = 0;
+            if(dispatcher_type::attempt(index, group, ctx, request_method, subject, subject_decoded, send, status)){
+                return status;
+            }
+        }
+        if(best){
+            captures_type arguments;
+            arguments.reserve(best_captures.size());
+            for(const auto& span: best_captures){
+                arguments.push_back(boost::string_view(subject_decoded.data() + span.first, span.second));
+            }
+            return dispatcher_type::invoke(best, group, ctx, request_method, subject, arguments, send);
+        }
+        return internal::group_at<0, group_type>::get(group).serve(ctx, request_method, subject, send);
+    }
+    template <typename AttachmentT>
+    self_type& listen(boost::asio::io_service& io, AttachmentT& attachment, int port=9198){
+        return listen(io, attachment, udho::endpoint::tcp4(port));
+    }
+    template <typename AttachmentT>
+    self_type& listen(boost::asio::io_service& io, AttachmentT& attachment, const udho::endpoint& endpoint){
+        udho::listen(*this, io, attachment, endpoint);
+        return *this;
+    }
+    template <typename AttachmentT>
+    self_type& listen(udho::io_pool& pool, AttachmentT& attachment, int port=9198){
+        return listen(pool, attachment, udho::endpoint::tcp4(port));
+    }
+    template <typename AttachmentT>
+    self_type& listen(udho::io_pool& pool, AttachmentT& attachment, const udho::endpoint& endpoint){
+        udho::listen(*this, pool, attachment, endpoint);
+        return *this;
+    }
+};
+
+/**
+ * indexes an overload chain in a radix tree
+ * @see radix_router
+ * @ingroup routing
+ */
+template <typename U, typename V>
+radix_router<overload_group<U, V>> radix(const overload_group<U, V>& group){
+    return radix_router<overload_group<U, V>>(group);
+}
+
+}
+
+#endif // UDHO_RADIX_H
@@ -0,0 +1,392 @@
+/*
+ * Copyright (c) 2020, Neel Basu <neel.basu.z@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <organization> nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Neel Basu <neel.basu.z@gmail.com> ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Neel Basu <neel.basu.z@gmail.com> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef UDHO_RANGES_H
+#define UDHO_RANGES_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <sstream>
+#include <algorithm>
+#include <boost/format.hpp>
+#include <boost/optional.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/asio/buffer.hpp>
+#include <boost/uuid/uuid.hpp>
+#include <boost/uuid/uuid_io.hpp>
+#include <boost/uuid/uuid_generators.hpp>
+#include <boost/beast/core/file.hpp>
+#include <boost/beast/core/error.hpp>
+#include <boost/beast/http/verb.hpp>
+#include <boost/beast/http/status.hpp>
+#include <boost/beast/http/message.hpp>
+#include <boost/algorithm/string/trim.hpp>
+#include <udho/util.h>
+
+namespace udho{
+
+/**
+ * body of a static file response that consists of byte ranges of a file or of an in memory copy of it.
+ * Each part is preceded by an optional head (e.g. the headers of a multipart/byteranges part) and the
+ * body ends with an optional tail. Only the bytes of the parts are read from the file, using sendfile where available.
+ * \ingroup server
+ */
+struct ranged_file_body{
+    struct part{
+        std::string   _head;
+        std::uint64_t _offset;
+        std::uint64_t _length;
+    };
+    class value_type{
+        boost::beast::file                 _file;
+        std::shared_ptr<const std::string> _content;
+        std::uint64_t                      _extent;
+        std::vector<part>                  _parts;
+        std::string                        _tail;
+      public:
+        value_type(): _extent(0){}
+        /**
+         * opens the file for reading. The parts are read from the file.
+         */
+        void open(const char* path, boost::beast::error_code& ec){
+            _file.open(path, boost::beast::file_mode::read, ec);
+            if(!ec){
+                _extent = _file.size(ec);
+            }
+        }
+        /**
+         * reads the parts from the in memory copy of the file instead
+         */
+        void assign(std::shared_ptr<const std::string> content){
+            _content = content;
+            _extent  = content ? content->size() : 0;
+        }
+        bool is_open() const{
+            return _file.is_open();
+        }
+        boost::beast::file& file(){
+            return _file;
+        }
+        const std::shared_ptr<const std::string>& content() const{
+            return _content;
+        }
+        /**
+         * size of the file
+         */
+        std::uint64_t extent() const{
+            return _extent;
+        }
+        void add(std::uint64_t offset, std::uint64_t length, const std::string& head = ""){
+            _parts.push_back(part{head, offset, length});
+        }
+        void tail(const std::string& tail){
+            _tail = tail;
+        }
+        /**
+         * drops the parts, e.g. for a response to a HEAD request after the Content-Length has been set
+         */
+        void clear(){
+            _parts.clear();
+            _tail.clear();
+        }
+        const std::vector<part>& parts() const{
+            return _parts;
+        }
+        const std::string& tail() const{
+            return _tail;
+        }
+        /**
+         * number of bytes in the body
+         */
+        std::uint64_t size() const{
+            std::uint64_t bytes = _tail.size();
+            for(const part& p: _parts){
+                bytes += p._head.size() + p._length;
+            }
+            return bytes;
+        }
+    };
+
+    static std::uint64_t size(const value_type& body){
+        return body.size();
+    }
+
+    class writer{
+        enum { chunk = 64 * 1024 };
+
+        value_type&   _body;
+        std::size_t   _part;
+        bool          _head;
+        std::uint64_t _position;
+        bool          _tail;
+        std::string   _buffer;
+      public:
+        typedef boost::asio::const_buffer const_buffers_type;
+
+        template <bool isRequest, class Fields>
+        explicit writer(boost::beast::http::header<isRequest, Fields>& /*header*/, value_type& body): _body(body), _part(0), _head(true), _position(0), _tail(false){}
+        void init(boost::beast::error_code& ec){
+            ec = {};
+        }
+        boost::optional<std::pair<const_buffers_type, bool>> get(boost::beast::error_code& ec){
+            ec = {};
+            const std::vector<part>& parts = _body.parts();
+            while(_part < parts.size()){
+                const part& p = parts[_part];
+                if(_head){
+                    _head = false;
+                    if(!p._head.empty()){
+                        return {{const_buffers_type(p._head.data(), p._head.size()), true}};
+                    }
+                }
+                if(_position < p._length){
+                    std::size_t amount = static_cast<std::size_t>(std::min<std::uint64_t>(p._length - _position, chunk));
+                    const_buffers_type buffer;
+                    if(_body.content()){
+                        buffer = const_buffers_type(_body.content()->data() + p._offset + _position, amount);
+                    }else{
+                        _buffer.resize(amount);
+                        _body.file().seek(p._offset + _position, ec);
+                        if(ec){
+                            return boost::none;
+                        }
+                        std::size_t read = _body.file().read(&_buffer[0], amount, ec);
+                        if(ec){
+                            return boost::none;
+                        }
+                        if(read == 0){
+                            // the file has been truncated after its size was read
+                            ec = boost::beast::errc::make_error_code(boost::beast::errc::io_error);
+                            return boost::none;
+                        }
+                        amount = read;
+                        buffer = const_buffers_type(_buffer.data(), amount);
+                    }
+                    _position += amount;
+                    return {{buffer, true}};
+                }
+                ++_part;
+                _head = true;
+                _position = 0;
+            }
+            if(!_tail && !_body.tail().empty()){
+                _tail = true;
+                return {{const_buffers_type(_body.tail().data(), _body.tail().size()), false}};
+            }
+            return boost::none;
+        }
+    };
+};
+
+/**
+ * inclusive range of bytes
+ * \ingroup server
+ */
+struct byte_range{
+    std::uint64_t _first;
+    std::uint64_t _last;
+
+    std::uint64_t length() const{
+        return _last - _first + 1;
+    }
+};
+
+namespace internal{
+
+    enum class range_status{
+        full,          ///< no usable Range header, the whole representation has to be sent
+        partial,       ///< at least one of the ranges is satisfiable
+        unsatisfiable  ///< none of the ranges is satisfiable
+    };
+
+    /**
+     * parses the value of a Range header against a representation of the given size.
+     * Syntactically invalid headers and units other than bytes are ignored as required by RFC 7233.
+     * Overlapping and adjacent ranges are coalesced and ranges are sorted by offset, so that a request
+     * cannot make the server send the same bytes more than once.
+     *
+     * @param limit maximum number of ranges honored after coalescing, the whole representation is sent otherwise
+     */
+    inline range_status parse_ranges(const std::string& header, std::uint64_t size, std::vector<byte_range>& ranges, std::size_t limit = 16){
+        ranges.clear();
+        std::string value = header;
+        boost::algorithm::trim(value);
+        if(value.compare(0, 6, "bytes=") != 0){
+            return range_status::full;
+        }
+        std::stringstream stream(value.substr(6));
+        std::string spec;
+        bool specified = false;
+        while(std::getline(stream, spec, ',')){
+            boost::algorithm::trim(spec);
+            if(spec.empty()){
+                continue;
+            }
+            std::size_t dash = spec.find('-');
+            if(dash == std::string::npos || spec.find_first_not_of("0123456789-") != std::string::npos || spec.find('-', dash+1) != std::string::npos){
+                return range_status::full;
+            }
+            std::string first = spec.substr(0, dash), last = spec.substr(dash+1);
+            if((first.empty() && last.empty()) || first.size() > 19 || last.size() > 19){
+                return range_status::full;
+            }
+            specified = true;
+            if(first.empty()){
+                std::uint64_t suffix = std::stoull(last);
+                if(suffix > 0 && size > 0){
+                    ranges.push_back(byte_range{size > suffix ? size - suffix : 0, size - 1});
+                }
+                continue;
+            }
+            std::uint64_t from = std::stoull(first);
+            std::uint64_t to   = last.empty() ? size - 1 : std::stoull(last);
+            if(!last.empty() && to < from){
+                return range_status::full;
+            }
+            if(from >= size){
+                continue;
+            }
+            ranges.push_back(byte_range{from, std::min<std::uint64_t>(to, size - 1)});
+        }
+        if(!specified){
+            return range_status::full;
+        }
+        if(ranges.empty()){
+            return range_status::unsatisfiable;
+        }
+        std::sort(ranges.begin(), ranges.end(), [](const byte_range& l, const byte_range& r){ return l._first < r._first; });
+        std::vector<byte_range> coalesced;
+        for(const byte_range& range: ranges){
+            if(!coalesced.empty() && range._first <= coalesced.back()._last + 1){
+                coalesced.back()._last = std::max(coalesced.back()._last, range._last);
+            }else{
+                coalesced.push_back(range);
+            }
+        }
+        ranges.swap(coalesced);
+        if(ranges.size() > limit){
+            ranges.clear();
+            return range_status::full;
+        }
+        return range_status::partial;
+    }
+
+    /**
+     * evaluates the If-Range header of the request against the validators of the representation.
+     * An entity tag is compared strongly, a date has to be an exact match of Last-Modified.
+     * @return true if there is no If-Range header or it matches, i.e. the Range header has to be honored
+     */
+    template <typename RequestT>
+    bool if_range(const RequestT& req, const std::string& etag, const std::string& last_modified){
+        auto header = req[boost::beast::http::field::if_range];
+        if(header.empty()){
+            return true;
+        }
+        std::string value = header.to_string();
+        boost::algorithm::trim(value);
+        if(value.compare(0, 2, "W/") == 0){
+            return false;
+        }
+        if(!value.empty() && value.front() == '"'){
+            return !etag.empty() && value == etag;
+        }
+        std::time_t since, modified;
+        return !last_modified.empty() && parse_http_date(value, since) && parse_http_date(last_modified, modified) && since == modified;
+    }
+
+    /**
+     * sets the Last-Modified header and an entity tag derived from the mtime and size of a file that is sent from disk
+     */
+    template <typename MessageT>
+    void file_validators(MessageT& res, const boost::filesystem::path& local_path){
+        boost::system::error_code ec;
+        std::time_t   mtime = boost::filesystem::last_write_time(local_path, ec);
+        std::uint64_t size  = boost::filesystem::file_size(local_path, ec);
+        if(ec){
+            return;
+        }
+        res.set(boost::beast::http::field::etag, (boost::format("\"%x-%x\"") % mtime % size).str());
+        res.set(boost::beast::http::field::last_modified, http_date(mtime));
+    }
+
+}
+
+/**
+ * selects the parts of a static file response according to the Range and If-Range headers of a GET or HEAD request.
+ * The response must have the body opened or assigned, and its ETag and Last-Modified headers set if available.
+ * Sets Accept-Ranges, the status (200, 206 or 416), Content-Range or a multipart/byteranges Content-Type and the Content-Length.
+ * The parts are dropped for HEAD requests after the Content-Length has been set.
+ *
+ * @param res the response
+ * @param req the request
+ * @param mime mime type of the file
+ * \ingroup server
+ */
+template <typename RequestT, typename Fields>
+void select_ranges(boost::beast::http::response<ranged_file_body, Fields>& res, const RequestT& req, const std::string& mime){
+    namespace http = boost::beast::http;
+    ranged_file_body::value_type& body = res.body();
+    const std::uint64_t extent = body.extent();
+    res.set(http::field::accept_ranges, "bytes");
+    std::vector<byte_range> ranges;
+    internal::range_status status = internal::range_status::full;
+    auto range = req[http::field::range];
+    bool ranged_method = req.method() == http::verb::get || req.method() == http::verb::head;
+    if(ranged_method && !range.empty() && internal::if_range(req, res[http::field::etag].to_string(), res[http::field::last_modified].to_string())){
+        status = internal::parse_ranges(range.to_string(), extent, ranges);
+    }
+    if(status == internal::range_status::unsatisfiable){
+        res.result(http::status::range_not_satisfiable);
+        res.set(http::field::content_range, (boost::format("bytes */%1%") % extent).str());
+    }else if(status == internal::range_status::partial && ranges.size() == 1){
+        res.result(http::status::partial_content);
+        res.set(http::field::content_range, (boost::format("bytes %1%-%2%/%3%") % ranges[0]._first % ranges[0]._last % extent).str());
+        body.add(ranges[0]._first, ranges[0].length());
+    }else if(status == internal::range_status::partial){
+        std::string boundary = boost::uuids::to_string(boost::uuids::random_generator()());
+        res.result(http::status::partial_content);
+        res.set(http::field::content_type, "multipart/byteranges; boundary="+boundary);
+        for(std::size_t i = 0; i < ranges.size(); ++i){
+            std::string head = (boost::format("%1%--%2%\r\nContent-Type: %3%\r\nContent-Range: bytes %4%-%5%/%6%\r\n\r\n") % (i ? "\r\n" : "") % boundary % mime % ranges[i]._first % ranges[i]._last % extent).str();
+            body.add(ranges[i]._first, ranges[i].length(), head);
+        }
+        body.tail((boost::format("\r\n--%1%--\r\n") % boundary).str());
+    }else{
+        body.add(0, extent);
+    }
+    res.content_length(body.size());
+    if(req.method() == http::verb::head){
+        body.clear();
+    }
+}
+
+}
+
+#endif // UDHO_RANGES_H
@@ -0,0 +1,191 @@
+/*
+ * Copyright (c) 2020, Neel Basu <neel.basu.z@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <organization> nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Neel Basu <neel.basu.z@gmail.com> ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Neel Basu <neel.basu.z@gmail.com> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef UDHO_REGISTRY_H
+#define UDHO_REGISTRY_H
+
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <functional>
+
+namespace udho{
+
+/**
+ * registry of the live connections and listeners of a server, shared by all io_contexts of an io_pool.
+ * Each member leaves a drain callback that is called once the server starts draining, e.g. on SIGINT or SIGTERM.
+ * Listeners stop accepting and connections close as soon as their in-flight requests are responded.
+ * @code
+ * server._attachment.aux().connections().live();
+ * server.drain();
+ * @endcode
+ * \ingroup server
+ */
+class registry{
+    struct state{
+        typedef std::map<std::uint64_t, std::function<void ()>> members_type;
+        
+        std::mutex _mutex;
+        members_type _connections;
+        members_type _listeners;
+        std::uint64_t _next;
+        std::atomic<std::size_t> _live;
+        std::atomic<std::uint64_t> _accepted;
+        std::atomic<bool> _draining;
+        
+        state(): _next(0), _live(0), _accepted(0), _draining(false){}
+    };
+    std::shared_ptr<state> _state;
+  public:
+    /**
+     * keeps a connection or a listener registered until destroyed, may outlive the registry
+     */
+    class membership{
+        std::shared_ptr<state> _state;
+        std::uint64_t _id;
+        bool _connection;
+      public:
+        membership(): _id(0), _connection(false){}
+        membership(std::shared_ptr<state> s, std::uint64_t id, bool connection): _state(s), _id(id), _connection(connection){}
+        membership(const membership&) = delete;
+        membership& operator=(const membership&) = delete;
+        membership(membership&& other): _state(std::move(other._state)), _id(other._id), _connection(other._connection){
+            other._state.reset();
+        }
+        membership& operator=(membership&& other){
+            if(this != &other){
+                leave();
+                _state = std::move(other._state);
+                _id = other._id;
+                _connection = other._connection;
+                other._state.reset();
+            }
+            return *this;
+        }
+        ~membership(){
+            leave();
+        }
+        /**
+         * unregisters the member
+         */
+        void leave(){
+            if(!_state) return;
+            std::lock_guard<std::mutex> lock(_state->_mutex);
+            if(_connection){
+                if(_state->_connections.erase(_id)){
+                    _state->_live.fetch_sub(1, std::memory_order_relaxed);
+                }
+            }else{
+                _state->_listeners.erase(_id);
+            }
+            _state.reset();
+        }
+    };
+    
+    registry(): _state(std::make_shared<state>()){}
+    registry(const registry&) = delete;
+    registry& operator=(const registry&) = delete;
+    
+    /**
+     * registers a live connection, drain is called right away if the server is already draining
+     * @param drain asks the connection to close once its in-flight requests are responded
+     */
+    membership enter(std::function<void ()> drain){
+        return join(drain, true);
+    }
+    /**
+     * registers a listener, drain is called right away if the server is already draining
+     * @param drain asks the listener to stop accepting and to stop its io_context once the connections are closed
+     */
+    membership watch(std::function<void ()> drain){
+        return join(drain, false);
+    }
+    /**
+     * starts draining the server, calls the drain callbacks of all the registered listeners and connections once
+     * @return false if the server was already draining
+     */
+    bool drain(){
+        if(_state->_draining.exchange(true)){
+            return false;
+        }
+        std::vector<std::function<void ()>> callbacks;
+        {
+            std::lock_guard<std::mutex> lock(_state->_mutex);
+            for(const auto& listener: _state->_listeners) callbacks.push_back(listener.second);
+            for(const auto& connection: _state->_connections) callbacks.push_back(connection.second);
+        }
+        for(const std::function<void ()>& callback: callbacks){
+            callback();
+        }
+        return true;
+    }
+    /**
+     * whether the server is draining
+     */
+    bool draining() const{
+        return _state->_draining.load();
+    }
+    /**
+     * number of connections that are open now
+     */
+    std::size_t live() const{
+        return _state->_live.load(std::memory_order_relaxed);
+    }
+    /**
+     * number of connections registered since the server started
+     */
+    std::uint64_t accepted() const{
+        return _state->_accepted.load(std::memory_order_relaxed);
+    }
+  private:
+    membership join(std::function<void ()> drain, bool connection){
+        std::uint64_t id;
+        {
+            std::lock_guard<std::mutex> lock(_state->_mutex);
+            id = ++_state->_next;
+            if(connection){
+                _state->_connections.insert(std::make_pair(id, drain));
+                _state->_live.fetch_add(1, std::memory_order_relaxed);
+                _state->_accepted.fetch_add(1, std::memory_order_relaxed);
+            }else{
+                _state->_listeners.insert(std::make_pair(id, drain));
+            }
+        }
+        if(_state->_draining.load()){
+            drain();
+        }
+        return membership(_state, id, connection);
+    }
+};
+
+}
+
+#endif // UDHO_REGISTRY_H
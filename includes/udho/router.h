@@ -1,7 +1,16 @@
 #ifndef ROUTER_H
 #define ROUTER_H
 
+#include <map>
 #include <deque>
+#include <limits>
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+#include <cctype>
+#include <type_traits>
+#include <functional>
+#include <algorithm>
 #include <boost/beast/core.hpp>
 #include <boost/beast/http.hpp>
 #include <boost/beast/version.hpp>
@@ -13,13 +22,18 @@
 #include <boost/mpl/int.hpp>
 #include <boost/fusion/tuple.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/lexical_cast/try_lexical_convert.hpp>
+#include <boost/utility/string_view.hpp>
 #include <boost/fusion/functional/invocation/invoke.hpp>
 #include <boost/regex.hpp>
 #include <boost/locale.hpp>
+#include <boost/algorithm/string/replace.hpp>
 #include <iomanip>
 #include <udho/contexts.h>
 #include <udho/compositors.h>
+#include <udho/sse.h>
 #include <udho/listener.h>
+#include <udho/io_pool.h>
 #include <udho/connection.h>
 #include "util.h"
 
@@ -71,40 +85,217 @@ namespace internal{
         return to_fusion(std::make_index_sequence<sizeof...(Ts)>{}, std::move(in) );
     }
     
-    template <typename T, int Index>
-    struct cast_optionally{
-        static T cast(const std::vector<std::string>& args){
-            try{
-                return boost::lexical_cast<T>(args[Index]);
-            }catch(...){
-                return T();
+    /**
+     * integral types that are parsed as numbers. Character types are excluded because they are parsed as characters.
+     */
+    template <typename T>
+    struct is_numeric_integer: std::integral_constant<bool, 
+        std::is_integral<T>::value && 
+        !std::is_same<T, bool>::value && 
+        !std::is_same<T, char>::value && 
+        !std::is_same<T, signed char>::value && 
+        !std::is_same<T, unsigned char>::value && 
+        !std::is_same<T, wchar_t>::value && 
+        !std::is_same<T, char16_t>::value && 
+        !std::is_same<T, char32_t>::value
+    >{};
+    
+    /**
+     * parses a captured argument of an url into T without allocating.
+     * The generic version falls back to boost::lexical_cast semantics.
+     * @return false if the text is not a valid T
+     */
+    template <typename T, typename Enable = void>
+    struct argument_parser{
+        static bool parse(const boost::string_view& text, T& value){
+            return boost::conversion::try_lexical_convert(text.data(), text.size(), value);
+        }
+    };
+    
+    /**
+     * parses signed and unsigned integers with optional sign, rejecting overflow and trailing characters
+     */
+    template <typename T>
+    struct argument_parser<T, std::enable_if_t<is_numeric_integer<T>::value>>{
+        typedef std::make_unsigned_t<T> unsigned_type;
+        
+        static bool parse(const boost::string_view& text, T& value){
+            auto it = text.begin();
+            bool negative = false;
+            if(it != text.end() && (*it == '-' || *it == '+')){
+                negative = (*it == '-');
+                ++it;
+            }
+            if(it == text.end() || (negative && std::is_unsigned<T>::value)){
+                return false;
             }
+            const unsigned_type limit = negative ? static_cast<unsigned_type>(static_cast<unsigned_type>(std::numeric_limits<T>::max()) + 1) : static_cast<unsigned_type>(std::numeric_limits<T>::max());
+            unsigned_type result = 0;
+            for(; it != text.end(); ++it){
+                if(*it < '0' || *it > '9'){
+                    return false;
+                }
+                unsigned_type digit = static_cast<unsigned_type>(*it - '0');
+                if(result > (limit - digit) / 10){
+                    return false;
+                }
+                result = result * 10 + digit;
+            }
+            value = negative ? static_cast<T>(0 - result) : static_cast<T>(result);
+            return true;
         }
     };
     
+    inline float  string_to_floating(const char* str, char** end, float*){       return std::strtof(str, end);  }
+    inline double string_to_floating(const char* str, char** end, double*){      return std::strtod(str, end);  }
+    inline long double string_to_floating(const char* str, char** end, long double*){ return std::strtold(str, end); }
+    
+    /**
+     * parses floating point numbers through a stack buffer, rejecting leading spaces and trailing characters
+     */
+    template <typename T>
+    struct argument_parser<T, std::enable_if_t<std::is_floating_point<T>::value>>{
+        static bool parse(const boost::string_view& text, T& value){
+            char buffer[64];
+            if(text.empty() || std::isspace(static_cast<unsigned char>(text.front()))){
+                return false;
+            }
+            if(text.size() >= sizeof(buffer)){
+                return boost::conversion::try_lexical_convert(text.data(), text.size(), value);
+            }
+            std::memcpy(buffer, text.data(), text.size());
+            buffer[text.size()] = 0;
+            char* end = nullptr;
+            errno = 0;
+            T result = string_to_floating(buffer, &end, static_cast<T*>(nullptr));
+            if(end != buffer + text.size() || errno == ERANGE){
+                return false;
+            }
+            value = result;
+            return true;
+        }
+    };
+    
+    template <>
+    struct argument_parser<std::string>{
+        static bool parse(const boost::string_view& text, std::string& value){
+            value.assign(text.data(), text.size());
+            return true;
+        }
+    };
+    
+    /**
+     * a handler taking a boost::string_view refers to the decoded path which lives as long as the handler is being called
+     */
+    template <>
+    struct argument_parser<boost::string_view>{
+        static bool parse(const boost::string_view& text, boost::string_view& value){
+            value = text;
+            return true;
+        }
+    };
+    
+    /**
+     * number of captured arguments and the argument at position index (starting from 0) of a matched request.
+     * The whole match at position 0 of a regex match is not an argument.
+     */
+    inline std::size_t captures_count(const boost::smatch& caps){
+        return caps.empty() ? 0 : caps.size() - 1;
+    }
+    inline boost::string_view capture_at(const boost::smatch& caps, std::size_t index){
+        const boost::ssub_match& capture = caps[index+1];
+        return capture.matched ? boost::string_view(&*capture.first, capture.length()) : boost::string_view();
+    }
+    template <typename StringT>
+    std::size_t captures_count(const std::vector<StringT>& args){
+        return args.size();
+    }
+    template <typename StringT>
+    boost::string_view capture_at(const std::vector<StringT>& args, std::size_t index){
+        return boost::string_view(args[index].data(), args[index].size());
+    }
+    
+    /**
+     * converts the captured argument at Index-1 to the Index'th element of the tuple. The 0'th element is the context.
+     * A missing or malformed argument leaves a default constructed value.
+     */
     template <typename TupleT, int Index=boost::tuples::length<TupleT>::value-1>
     struct arg_to_tuple: arg_to_tuple<TupleT, Index-1>{
         typedef arg_to_tuple<TupleT, Index-1> base_type;
+        typedef typename boost::tuples::element<Index, TupleT>::type element_type;
         
-        static void convert(TupleT& tuple, const std::vector<std::string>& args){
-            boost::get<Index>(tuple) = cast_optionally<typename boost::tuples::element<Index, TupleT>::type, Index>::cast(args);
-            base_type::convert(tuple, args);
+        template <typename CapturesT>
+        static bool convert(TupleT& tuple, const CapturesT& captures){
+            bool parsed = false;
+            if(Index-1 < static_cast<int>(captures_count(captures))){
+                parsed = argument_parser<element_type>::parse(capture_at(captures, Index-1), boost::get<Index>(tuple));
+                if(!parsed){
+                    boost::get<Index>(tuple) = element_type();
+                }
+            }
+            return base_type::convert(tuple, captures) && parsed;
         }
     };
     
     template <typename TupleT>
     struct arg_to_tuple<TupleT, 0>{
-        static void convert(TupleT& /*tuple*/, const std::vector<std::string>& /*args*/){
-            // boost::get<0>(tuple) = cast_optionally<typename boost::tuples::element<0, TupleT>::type, 0>::cast(args);
+        template <typename CapturesT>
+        static bool convert(TupleT& /*tuple*/, const CapturesT& /*captures*/){
+            return true;
         }
     };
     
-    template <typename TupleT>
-    void arguments_to_tuple(TupleT& tuple, const std::vector<std::string>& args){
-        arg_to_tuple<TupleT>::convert(tuple, args);
+    /**
+     * @return false if any of the arguments is missing or could not be parsed
+     */
+    template <typename TupleT, typename CapturesT>
+    bool arguments_to_tuple(TupleT& tuple, const CapturesT& captures){
+        return arg_to_tuple<TupleT>::convert(tuple, captures);
+    }
+    
+#ifdef WITH_ICU
+    typedef boost::u32regex regex_type;
+#else
+    typedef boost::regex    regex_type;
+#endif
+    
+    /**
+     * expands the typed placeholders `{int}` and `{string}` of an url pattern to `(\\d+)` and `([^/]+)` respectively
+     */
+    inline std::string expand_placeholders(const std::string& pattern){
+        std::string expanded = boost::algorithm::replace_all_copy(pattern, "{int}", "(\\d+)");
+        boost::algorithm::replace_all(expanded, "{string}", "([^/]+)");
+        return expanded;
+    }
+    /**
+     * compiles an url pattern once so that it can be matched against many requests
+     */
+    inline regex_type compile_pattern(const std::string& pattern){
+#ifdef WITH_ICU
+        return boost::make_u32regex(pattern);
+#else
+        return boost::regex(pattern);
+#endif
+    }
+    inline bool search_pattern(const std::string& subject, boost::smatch& caps, const regex_type& regex){
+#ifdef WITH_ICU
+        return boost::u32regex_search(subject, caps, regex);
+#else
+        return boost::regex_search(subject, caps, regex);
+#endif
+    }
+    inline bool search_pattern(const std::string& subject, const regex_type& regex){
+#ifdef WITH_ICU
+        return boost::u32regex_search(subject, regex);
+#else
+        return boost::regex_search(subject, regex);
+#endif
     }
 }
 
+template <typename OverloadT>
+struct blocking_overload;
+
 /**
  * \ingroup routing
  * \ingroup overload
@@ -121,46 +312,80 @@ struct module_overload{
     
     boost::beast::http::verb _request_method;
     std::string              _pattern;
+    internal::regex_type     _regex;
     function_type            _function;
     compositor_type          _compositor;
+    bool                     _strict;
     
-    module_overload(boost::beast::http::verb request_method, function_type f, compositor_type compositor=compositor_type()): _request_method(request_method), _function(f), _compositor(compositor){}
-    module_overload(const self_type& other): _request_method(other._request_method), _pattern(other._pattern), _function(other._function), _compositor(other._compositor){}
+    module_overload(boost::beast::http::verb request_method, function_type f, compositor_type compositor=compositor_type()): _request_method(request_method), _function(f), _compositor(compositor), _strict(false){}
+    module_overload(const self_type& other): _request_method(other._request_method), _pattern(other._pattern), _regex(other._regex), _function(other._function), _compositor(other._compositor), _strict(other._strict){}
 
     std::string pattern() const{
         return _pattern;
     }
+    /**
+     * attach an url pattern. The typed placeholders `{int}` and `{string}` are expanded and the pattern is compiled once here and reused for every request.
+     */
     self_type& operator=(const std::string& pattern){
-        _pattern = pattern;
+        _pattern = internal::expand_placeholders(pattern);
+        _regex   = internal::compile_pattern(_pattern);
         return *this;
     }
     /**
      * check number of arguments supplied on runtime and number of arguments with which this overload has been prepared at compile time.
      */
     bool feasible(boost::beast::http::verb request_method, const std::string& subject) const{
-        if(_pattern.empty()){
+        if(_pattern.empty() || request_method != _request_method){
             return false;
         }
         std::string subject_decoded = udho::util::urldecode(subject);
-        // std::cout << "_pattern " << _pattern << " " << " subject " << subject_decoded << std::endl;
-#ifdef WITH_ICU
-        return (request_method == _request_method) && boost::u32regex_search(subject_decoded, boost::make_u32regex(_pattern));
-#else
-        return (request_method == _request_method) && boost::regex_search(subject_decoded, boost::regex(_pattern));
-#endif
+        return internal::search_pattern(subject_decoded, _regex);
     }
-    template <typename T>
-    return_type call(T& value, const std::vector<std::string>& args){
-        std::deque<std::string> argsq;
-        std::copy(args.begin(), args.end(), std::back_inserter(argsq));
+    /**
+     * matches the already urldecoded subject against the compiled pattern and stores the captures in caps.
+     * The captures refer to subject_decoded which must outlive caps.
+     */
+    bool feasible(boost::beast::http::verb request_method, const std::string& subject_decoded, boost::smatch& caps) const{
+        if(_pattern.empty() || request_method != _request_method){
+            return false;
+        }
+        return internal::search_pattern(subject_decoded, caps, _regex);
+    }
+    /**
+     * reject requests with missing or malformed arguments with 400 Bad Request instead of calling the function with default constructed arguments
+     */
+    self_type& strict(bool flag = true){
+        _strict = flag;
+        return *this;
+    }
+    /**
+     * compress the response of a mimed overload e.g. `udho::get(f).json().compressed()` with the coding negotiated from Accept-Encoding
+     * @param level compression level 0 - 9, -1 for zlib's default
+     * @param min_size bodies smaller than this are sent uncompressed
+     * @param streaming bodies larger than this are compressed while being written, 0 to always compress in memory
+     * \see udho::compositors::compressed
+     */
+    auto compressed(int level = -1, std::size_t min_size = 1024, std::size_t streaming = 0) const{
+        typedef module_overload<Function, compositors::compressed> compressed_type;
+        compressed_type overload(_request_method, _function, typename compressed_type::compositor_type(_compositor._mime, level, min_size, streaming));
+        overload._pattern = _pattern;
+        overload._regex   = _regex;
+        overload._strict  = _strict;
+        return overload;
+    }
+    /**
+     * run the callback on the worker threads of the server instead of the io thread e.g. `udho::get(f).json().blocking()`
+     * \see udho::blocking_overload
+     */
+    blocking_overload<self_type> blocking() const{
+        return blocking_overload<self_type>(*this);
+    }
+    template <typename T, typename CapturesT>
+    return_type call(T& value, const CapturesT& captures){
         tuple_type tuple(value);
-        if(::boost::tuples::length<tuple_type>::value > args.size()){
-            argsq.push_front("");
+        if(!internal::arguments_to_tuple(tuple, captures) && _strict){
+            throw udho::exceptions::http_error(boost::beast::http::status::bad_request, "malformed arguments for "+_pattern);
         }
-        std::vector<std::string> args_str;
-        std::copy(argsq.begin(), argsq.end(), std::back_inserter(args_str));
-        internal::arguments_to_tuple(tuple, args_str);
-//         boost::get<0>(tuple) = value;
         arguments_type arguments = internal::to_fusion(tuple);
         // https://www.boost.org/doc/libs/1_68_0/libs/fusion/doc/html/fusion/functional/invocation/functions/invoke.html
         return boost::fusion::invoke(_function, arguments);
@@ -171,27 +396,21 @@ struct module_overload{
         return _compositor(value, std::move(ret));
     }
     template <typename T>
+    response_type operator()(T& value, const std::vector<boost::string_view>& args){
+        return_type ret = call(value, args);
+        return _compositor(value, std::move(ret));
+    }
+    template <typename T>
+    response_type operator()(T& value, const boost::smatch& caps){
+        return_type ret = call(value, caps);
+        return _compositor(value, std::move(ret));
+    }
+    template <typename T>
     response_type operator()(T& value, const std::string& subject){
-        std::vector<std::string> args;
         boost::smatch caps;
-        try{
-            std::string subject_decoded = udho::util::urldecode(subject);
-            // std::cout << "subject_decoded: " << subject_decoded << " _pattern: " << _pattern << std::endl;
-#ifdef WITH_ICU
-            if(boost::u32regex_search(subject_decoded, caps, boost::make_u32regex(_pattern))){
-#else
-            if(boost::regex_search(subject_decoded, caps, boost::regex(_pattern))){
-#endif
-                std::copy(caps.begin()+1, caps.end(), std::back_inserter(args));
-            }
-            // std::copy(args.begin(), args.end(), std::ostream_iterator<std::string>(std::cout, ", "));
-            // std::cout << std::endl;
-        }catch(const udho::exceptions::reroute&){
-            throw;
-        }catch(std::exception& ex){
-            std::cout << "ex: " << ex.what() << std::endl;
-        }
-        return operator()(value, args);
+        std::string subject_decoded = udho::util::urldecode(subject);
+        internal::search_pattern(subject_decoded, caps, _regex);
+        return operator()(value, caps);
     }
     module_info info() const{
         module_info inf;
@@ -206,7 +425,9 @@ struct module_overload{
             _request_method = other._request_method;
             _function = other._function;
             _pattern = other._pattern;
+            _regex = other._regex;
             _compositor = other._compositor;
+            _strict = other._strict;
             return *this;
         }
 };
@@ -227,46 +448,58 @@ struct module_overload<Function, compositors::deferred>{
     
     boost::beast::http::verb _request_method;
     std::string              _pattern;
+    internal::regex_type     _regex;
     function_type            _function;
     compositor_type          _compositor;
+    bool                     _strict;
     
-    module_overload(boost::beast::http::verb request_method, function_type f, compositor_type compositor=compositor_type()): _request_method(request_method), _function(f), _compositor(compositor){}
-    module_overload(const self_type& other): _request_method(other._request_method), _pattern(other._pattern), _function(other._function), _compositor(other._compositor){}
+    module_overload(boost::beast::http::verb request_method, function_type f, compositor_type compositor=compositor_type()): _request_method(request_method), _function(f), _compositor(compositor), _strict(false){}
+    module_overload(const self_type& other): _request_method(other._request_method), _pattern(other._pattern), _regex(other._regex), _function(other._function), _compositor(other._compositor), _strict(other._strict){}
 
     std::string pattern() const{
         return _pattern;
     }
+    /**
+     * attach an url pattern. The typed placeholders `{int}` and `{string}` are expanded and the pattern is compiled once here and reused for every request.
+     */
     self_type& operator=(const std::string& pattern){
-        _pattern = pattern;
+        _pattern = internal::expand_placeholders(pattern);
+        _regex   = internal::compile_pattern(_pattern);
         return *this;
     }
     /**
      * check number of arguments supplied on runtime and number of arguments with which this overload has been prepared at compile time.
      */
     bool feasible(boost::beast::http::verb request_method, const std::string& subject) const{
-        if(_pattern.empty()){
+        if(_pattern.empty() || request_method != _request_method){
             return false;
         }
         std::string subject_decoded = udho::util::urldecode(subject);
-        // std::cout << "_pattern " << _pattern << " " << " subject " << subject_decoded << std::endl;
-#ifdef WITH_ICU
-        return (request_method == _request_method) && boost::u32regex_search(subject_decoded, boost::make_u32regex(_pattern));
-#else
-        return (request_method == _request_method) && boost::regex_search(subject_decoded, boost::regex(_pattern));
-#endif
+        return internal::search_pattern(subject_decoded, _regex);
     }
-    template <typename T>
-    void call(T& value, const std::vector<std::string>& args){
-        std::deque<std::string> argsq;
-        std::copy(args.begin(), args.end(), std::back_inserter(argsq));
+    /**
+     * matches the already urldecoded subject against the compiled pattern and stores the captures in caps.
+     * The captures refer to subject_decoded which must outlive caps.
+     */
+    bool feasible(boost::beast::http::verb request_method, const std::string& subject_decoded, boost::smatch& caps) const{
+        if(_pattern.empty() || request_method != _request_method){
+            return false;
+        }
+        return internal::search_pattern(subject_decoded, caps, _regex);
+    }
+    /**
+     * reject requests with missing or malformed arguments with 400 Bad Request instead of calling the function with default constructed arguments
+     */
+    self_type& strict(bool flag = true){
+        _strict = flag;
+        return *this;
+    }
+    template <typename T, typename CapturesT>
+    void call(T& value, const CapturesT& captures){
         tuple_type tuple(value);
-        if(::boost::tuples::length<tuple_type>::value > args.size()){
-            argsq.push_front("");
+        if(!internal::arguments_to_tuple(tuple, captures) && _strict){
+            throw udho::exceptions::http_error(boost::beast::http::status::bad_request, "malformed arguments for "+_pattern);
         }
-        std::vector<std::string> args_str;
-        std::copy(argsq.begin(), argsq.end(), std::back_inserter(args_str));
-        internal::arguments_to_tuple(tuple, args_str);
-//         boost::get<0>(tuple) = value;
         arguments_type arguments = internal::to_fusion(tuple);
         // https://www.boost.org/doc/libs/1_68_0/libs/fusion/doc/html/fusion/functional/invocation/functions/invoke.html
         boost::fusion::invoke(_function, arguments);
@@ -277,27 +510,21 @@ struct module_overload<Function, compositors::deferred>{
         _compositor();
     }
     template <typename T>
+    void operator()(T& value, const std::vector<boost::string_view>& args){
+        call(value, args);
+        _compositor();
+    }
+    template <typename T>
+    void operator()(T& value, const boost::smatch& caps){
+        call(value, caps);
+        _compositor();
+    }
+    template <typename T>
     void operator()(T& value, const std::string& subject){
-        std::vector<std::string> args;
         boost::smatch caps;
-        try{
-            std::string subject_decoded = udho::util::urldecode(subject);
-            // std::cout << "subject_decoded: " << subject_decoded << " _pattern: " << _pattern << std::endl;
-#ifdef WITH_ICU
-            if(boost::u32regex_search(subject_decoded, caps, boost::make_u32regex(_pattern))){
-#else
-            if(boost::regex_search(subject_decoded, caps, boost::regex(_pattern))){
-#endif
-                std::copy(caps.begin()+1, caps.end(), std::back_inserter(args));
-            }
-            // std::copy(args.begin(), args.end(), std::ostream_iterator<std::string>(std::cout, ", "));
-            // std::cout << std::endl;
-        }catch(const udho::exceptions::reroute&){
-            throw;
-        }catch(std::exception& ex){
-            std::cout << "ex: " << ex.what() << std::endl;
-        }
-        operator()(value, args);
+        std::string subject_decoded = udho::util::urldecode(subject);
+        internal::search_pattern(subject_decoded, caps, _regex);
+        operator()(value, caps);
     }
     module_info info() const{
         module_info inf;
@@ -312,11 +539,100 @@ struct module_overload<Function, compositors::deferred>{
             _request_method = other._request_method;
             _function = other._function;
             _pattern = other._pattern;
+            _regex = other._regex;
             _compositor = other._compositor;
+            _strict = other._strict;
             return *this;
         }
 };
 
+/**
+ * runs an overload on the worker threads of the server (`udho::configs::workers`) so that a slow callback does not stall the other connections of its io thread.
+ * The captured arguments are copied before the callback is queued and the composed response is delivered on the strand of the connection through ctx.respond().
+ * Requests beyond the configured limit of queued and running callbacks are answered with 503 Service Unavailable.
+ * The wrapped overload must compose a string response e.g. a mimed or a raw callback returning udho::defs::response_type.
+ * @code
+ * auto router = udho::router() | (udho::get(&report).json().blocking() = "^/report/(\\d+)$");
+ * @endcode
+ * \ingroup routing
+ * \ingroup overload
+ */
+template <typename OverloadT>
+struct blocking_overload{
+    typedef OverloadT                                   overload_type;
+    typedef blocking_overload<OverloadT>                self_type;
+    typedef void                                        response_type;
+    
+    static_assert(std::is_same<typename overload_type::response_type, udho::defs::response_type>::value, "only the overloads composing a string response can be run on the worker threads");
+    
+    boost::beast::http::verb _request_method;
+    overload_type            _overload;
+    
+    blocking_overload(const overload_type& overload): _request_method(overload._request_method), _overload(overload){}
+    
+    std::string pattern() const{
+        return _overload.pattern();
+    }
+    self_type& operator=(const std::string& pattern){
+        _overload = pattern;
+        return *this;
+    }
+    bool feasible(boost::beast::http::verb request_method, const std::string& subject) const{
+        return _overload.feasible(request_method, subject);
+    }
+    bool feasible(boost::beast::http::verb request_method, const std::string& subject_decoded, boost::smatch& caps) const{
+        return _overload.feasible(request_method, subject_decoded, caps);
+    }
+    self_type& strict(bool flag = true){
+        _overload.strict(flag);
+        return *this;
+    }
+    /**
+     * queues the callback with a copy of the context and the captured arguments.
+     * A request that waited in the queue longer than the load shedding allows is answered with 503 Service Unavailable instead.
+     */
+    template <typename T, typename CapturesT>
+    void operator()(T& value, const CapturesT& captures){
+        std::vector<std::string> args;
+        args.reserve(internal::captures_count(captures));
+        for(std::size_t i = 0; i < internal::captures_count(captures); ++i){
+            args.push_back(internal::capture_at(captures, i).to_string());
+        }
+        overload_type* overload = &_overload;
+        T ctx(value);
+        std::chrono::steady_clock::time_point submitted = std::chrono::steady_clock::now();
+        bool queued = value.aux().blocking([overload, ctx, args, submitted]() mutable {
+            udho::defs::response_type res;
+            if(!ctx.aux().admit(std::chrono::steady_clock::now() - submitted)){
+                ctx << udho::logging::messages::formatted::warning("router", "shedding %1% after waiting too long for a worker thread") % ctx.request().target();
+                res = ctx.aux().shed("waited too long for a worker thread").response(ctx.request());
+                ctx.respond(res);
+                return;
+            }
+            try{
+                res = (*overload)(ctx, args);
+                ctx.patch(res);
+            }catch(const udho::exceptions::http_error& error){
+                res = error.response(ctx.request());
+            }catch(const std::exception& ex){
+                ctx << udho::logging::messages::formatted::error("router", "unhandled exception %1% while serving %2% on a worker thread") % ex.what() % ctx.request().target();
+                res = udho::exceptions::http_error(boost::beast::http::status::internal_server_error, (boost::format("unhandled exception %1% while serving %2%") % ex.what() % ctx.request().target()).str()).response(ctx.request());
+            }catch(...){
+                res = udho::exceptions::http_error(boost::beast::http::status::internal_server_error, "Server encountered an unknown error").response(ctx.request());
+            }
+            ctx.respond(res);
+        });
+        if(!queued){
+            throw value.aux().shed("too many blocking requests");
+        }
+    }
+    module_info info() const{
+        module_info inf = _overload.info();
+        inf._compositor = "BLOCKING " + inf._compositor;
+        return inf;
+    }
+};
+
 /**
  * \ingroup routing
  * \ingroup overload
@@ -456,6 +772,19 @@ struct content_wrapper1{
     auto json(){
         return mimed("application/json");
     }
+    /**
+     * keeps the connection open as a stream of server sent events, subscribed to the key returned by the callback
+     * @param hub the hub that broadcasts events to the subscribers
+     */
+    auto sse(udho::sse::hub<typename internal::function_signature<F>::return_type>& hub){
+        return unwrap(compositors::sse<typename internal::function_signature<F>::return_type>(hub));
+    }
+    /**
+     * upgrades the connection to a websocket with the handlers returned by the callback
+     */
+    auto websocket(const udho::websocket::options& options = udho::websocket::options()){
+        return unwrap(compositors::websocket<typename internal::function_signature<F>::return_type>(options));
+    }
 };
 
 /**
@@ -521,6 +850,19 @@ struct content_wrapper0{
     auto json(){
         return mimed("application/json");
     }
+    /**
+     * keeps the connection open as a stream of server sent events, subscribed to the key returned by the callback
+     * @param hub the hub that broadcasts events to the subscribers
+     */
+    auto sse(udho::sse::hub<typename internal::function_signature<F>::return_type>& hub){
+        return unwrap(compositors::sse<typename internal::function_signature<F>::return_type>(hub));
+    }
+    /**
+     * upgrades the connection to a websocket with the handlers returned by the callback
+     */
+    auto websocket(const udho::websocket::options& options = udho::websocket::options()){
+        return unwrap(compositors::websocket<typename internal::function_signature<F>::return_type>(options));
+    }
 };
 
 /**
@@ -661,9 +1003,9 @@ struct overload_group_helper{
     OverloadT& _overload;
     
     overload_group_helper(OverloadT& overload): _overload(overload){}
-    template <typename ContextT, typename Lambda>
-    int resolve(ContextT& ctx, Lambda send, const std::string& subject){
-        response_type res = _overload(ctx, subject);
+    template <typename ContextT, typename Lambda, typename MatchT>
+    int resolve(ContextT& ctx, Lambda send, const MatchT& match){
+        response_type res = _overload(ctx, match);
         http::status status = res.result();
         ctx.patch(res);
         if(ctx.alt_path().empty()){
@@ -686,9 +1028,9 @@ struct overload_group_helper<OverloadT, void>{
     OverloadT& _overload;
     
     overload_group_helper(OverloadT& overload): _overload(overload){}
-    template <typename ContextT, typename Lambda>
-    int resolve(ContextT& ctx, Lambda send, const std::string& subject){
-        _overload(ctx, subject);
+    template <typename ContextT, typename Lambda, typename MatchT>
+    int resolve(ContextT& ctx, Lambda send, const MatchT& match){
+        _overload(ctx, match);
         return ROUTING_DEFERRED;
     }
 };
@@ -705,6 +1047,7 @@ struct overload_group{
     typedef U            parent_type;       ///< type of the parient in the meta-chain of overloads
     typedef V            overload_type;     ///< type of the next child in the overload chain
     typedef typename parent_type::terminal_type terminal_type;
+    enum { depth = parent_type::depth + 1 }; ///< position of this overload in the chain, starting from 1
     
     parent_type   _parent;
     overload_type _overload;
@@ -724,40 +1067,102 @@ struct overload_group{
     template <typename ContextT, typename Lambda>
     int serve(ContextT& ctx, boost::beast::http::verb request_method, const std::string& subject, Lambda send){
         int status = 0;
-        if(_overload.feasible(request_method, subject)){
-            try{
-                ctx.push(udho::detail::route{ctx.path(), subject, _overload.pattern()});
-                overload_group_helper<overload_type> helper(_overload);
-                status = helper.resolve(ctx, send, subject);
-            }catch(const udho::exceptions::http_error& error){
-                send(std::move(error.response(ctx.request())));
-                return static_cast<int>(error.result());
-            }catch(const udho::exceptions::reroute&){
-                throw;
-            }catch(const std::exception& ex){
-                std::cout << ex.what() << std::endl;
-                ctx << udho::logging::messages::formatted::error("router", "unhandled exception %1% while serving %2% using method %3%") % ex.what() % subject % request_method;
-                udho::exceptions::http_error error(boost::beast::http::status::internal_server_error, (boost::format("unhandled exception %1% while serving %2% using method %3%") % ex.what() % subject % request_method).str());
-                send(std::move(error.response(ctx.request())));
-                return static_cast<int>(error.result());
-            }catch(...){
-                udho::exceptions::http_error error(boost::beast::http::status::internal_server_error);
-                send(std::move(error.response(ctx.request())));
-                return static_cast<int>(error.result());
-            }
+        if(attempt(ctx, request_method, subject, send, status)){
             return status;
         }else{
             return _parent.template serve<ContextT, Lambda>(ctx, request_method, subject, send);
         }
     }
+    /**
+     * serves the request using `_overload` only, if it is feasible. Never bubbles the request to the parent.
+     * 
+     * @param status the resulting status if `_overload` is feasible
+     * @return true if `_overload` is feasible for the request
+     */
+    template <typename ContextT, typename Lambda>
+    bool attempt(ContextT& ctx, boost::beast::http::verb request_method, const std::string& subject, Lambda send, int& status){
+        std::string subject_decoded;
+        if(request_method == _overload._request_method){
+            subject_decoded = udho::util::urldecode(subject);
+        }
+        return attempt(ctx, request_method, subject, subject_decoded, send, status);
+    }
+    /**
+     * serves the request using `_overload` only, if it is feasible, with the path already url decoded by the caller.
+     */
+    template <typename ContextT, typename Lambda>
+    bool attempt(ContextT& ctx, boost::beast::http::verb request_method, const std::string& subject, const std::string& subject_decoded, Lambda send, int& status){
+        boost::smatch caps;
+        if(_overload.feasible(request_method, subject_decoded, caps)){
+            status = invoke(ctx, request_method, subject, caps, send);
+            return true;
+        }
+        return false;
+    }
+    /**
+     * calls `_overload` with the captures of an already matched request
+     * 
+     * @param match regex match or captured arguments of the request path
+     */
+    template <typename ContextT, typename Lambda, typename MatchT>
+    int invoke(ContextT& ctx, boost::beast::http::verb request_method, const std::string& subject, const MatchT& match, Lambda send){
+        int status = 0;
+        try{
+            ctx.push(udho::detail::route{ctx.path(), subject, _overload.pattern()});
+            overload_group_helper<overload_type> helper(_overload);
+            status = helper.resolve(ctx, send, match);
+        }catch(const udho::exceptions::http_error& error){
+            send(std::move(error.response(ctx.request())));
+            return static_cast<int>(error.result());
+        }catch(const udho::exceptions::reroute&){
+            throw;
+        }catch(const std::exception& ex){
+            std::cout << ex.what() << std::endl;
+            ctx << udho::logging::messages::formatted::error("router", "unhandled exception %1% while serving %2% using method %3%") % ex.what() % subject % request_method;
+            udho::exceptions::http_error error(boost::beast::http::status::internal_server_error, (boost::format("unhandled exception %1% while serving %2% using method %3%") % ex.what() % subject % request_method).str());
+            send(std::move(error.response(ctx.request())));
+            return static_cast<int>(error.result());
+        }catch(...){
+            udho::exceptions::http_error error(boost::beast::http::status::internal_server_error);
+            send(std::move(error.response(ctx.request())));
+            return static_cast<int>(error.result());
+        }
+        return status;
+    }
+    /**
+     * describes the url mapping of `_overload`
+     * @return true as `_overload` is always a callable and never a mounted application
+     */
+    bool describe(module_info& info) const{
+        info = _overload.info();
+        return true;
+    }
     void summary(std::vector<module_info>& stack) const{
         stack.push_back(_overload.info());
         _parent.summary(stack);
     }
     template <typename AttachmentT>
     self_type& listen(boost::asio::io_service& io, AttachmentT& attachment, int port=9198){
-        typedef udho::listener<self_type, AttachmentT> listener_type;
-        std::make_shared<listener_type>(*this, io, attachment, boost::asio::ip::tcp::endpoint(boost::asio::ip::make_address("0.0.0.0"), port))->run();
+        return listen(io, attachment, udho::endpoint::tcp4(port));
+    }
+    /**
+     * listens on an IPv4 or IPv6 endpoint or a unix domain socket
+     */
+    template <typename AttachmentT>
+    self_type& listen(boost::asio::io_service& io, AttachmentT& attachment, const udho::endpoint& endpoint){
+        udho::listen(*this, io, attachment, endpoint);
+        return *this;
+    }
+    /**
+     * listens on every io_context of the pool with one SO_REUSEPORT acceptor per io_context
+     */
+    template <typename AttachmentT>
+    self_type& listen(udho::io_pool& pool, AttachmentT& attachment, int port=9198){
+        return listen(pool, attachment, udho::endpoint::tcp4(port));
+    }
+    template <typename AttachmentT>
+    self_type& listen(udho::io_pool& pool, AttachmentT& attachment, const udho::endpoint& endpoint){
+        udho::listen(*this, pool, attachment, endpoint);
         return *this;
     }
     template <typename F>
@@ -782,6 +1187,7 @@ struct overload_group<U, overload_terminal<V>>{
     typedef V                 overload_type;      ///< type of parent in the overoad meta-chain
     typedef U                 parent_type;    ///< type of the next child in the overload chain
     typedef overload_terminal<V> terminal_type;
+    enum { depth = 0 };
     
     terminal_type _terminal;
     
@@ -835,6 +1241,7 @@ struct overload_group<U, overload_terminal<void>>{
     typedef void              overload_type;      ///< type of parent in the overoad meta-chain
     typedef U                 parent_type;    ///< type of the next child in the overload chain
     typedef overload_terminal<void> terminal_type;
+    enum { depth = 0 };
     
     terminal_type _terminal;
     
@@ -907,6 +1314,208 @@ template <typename U, typename V, typename F>
 overload_group<overload_group<U, V>, F> operator<<(const overload_group<U, V>& group, const F& method){
     return overload_group<overload_group<U, V>, F>(group, method);
 }
+namespace internal{
+    /**
+     * compile time access to the overload group at position `I` of an overload chain. 
+     * The terminal group is at position 0 and the outermost group is at position `GroupT::depth`
+     */
+    template <std::size_t I, typename GroupT, bool Found = (static_cast<std::size_t>(GroupT::depth) == I)>
+    struct group_at;
+    
+    template <std::size_t I, typename GroupT>
+    struct group_at<I, GroupT, true>{
+        typedef GroupT type;
+        
+        static type& get(GroupT& group){
+            return group;
+        }
+    };
+    
+    template <std::size_t I, typename GroupT>
+    struct group_at<I, GroupT, false>{
+        typedef group_at<I, typename GroupT::parent_type> next_type;
+        typedef typename next_type::type type;
+        
+        static type& get(GroupT& group){
+            return next_type::get(group._parent);
+        }
+    };
+    
+    /**
+     * jump tables over the overloads of a chain so that an overload can be served by its position in O(1)
+     */
+    template <typename GroupT, typename ContextT, typename Lambda, typename MatchT>
+    struct group_dispatcher{
+        typedef int  (*invoke_type)(GroupT&, ContextT&, boost::beast::http::verb, const std::string&, const MatchT&, Lambda&);
+        typedef bool (*attempt_type)(GroupT&, ContextT&, boost::beast::http::verb, const std::string&, const std::string&, Lambda&, int&);
+        
+        template <std::size_t I>
+        static int invoke_at(GroupT& group, ContextT& ctx, boost::beast::http::verb request_method, const std::string& subject, const MatchT& match, Lambda& send){
+            return group_at<I, GroupT>::get(group).invoke(ctx, request_method, subject, match, send);
+        }
+        template <std::size_t I>
+        static bool attempt_at(GroupT& group, ContextT& ctx, boost::beast::http::verb request_method, const std::string& subject, const std::string& subject_decoded, Lambda& send, int& status){
+            return group_at<I, GroupT>::get(group).attempt(ctx, request_method, subject, subject_decoded, send, status);
+        }
+        template <std::size_t... I>
+        static const invoke_type* invokers(std::index_sequence<I...>){
+            static const invoke_type table[] = {nullptr, &invoke_at<I+1>...};
+            return table;
+        }
+        template <std::size_t... I>
+        static const attempt_type* attempters(std::index_sequence<I...>){
+            static const attempt_type table[] = {nullptr, &attempt_at<I+1>...};
+            return table;
+        }
+        /**
+         * calls the overload at position index with the captures of an already matched request
+         */
+        static int invoke(std::size_t index, GroupT& group, ContextT& ctx, boost::beast::http::verb request_method, const std::string& subject, const MatchT& match, Lambda& send){
+            return invokers(std::make_index_sequence<GroupT::depth>())[index](group, ctx, request_method, subject, match, send);
+        }
+        /**
+         * serves the request with the overload at position index if that is feasible
+         */
+        static bool attempt(std::size_t index, GroupT& group, ContextT& ctx, boost::beast::http::verb request_method, const std::string& subject, const std::string& subject_decoded, Lambda& send, int& status){
+            return attempters(std::make_index_sequence<GroupT::depth>())[index](group, ctx, request_method, subject, subject_decoded, send, status);
+        }
+    };
+    
+    template <typename GroupT, std::size_t... I>
+    void describe_overloads(const GroupT& group, std::vector<std::pair<module_info, bool>>& descriptions, std::index_sequence<I...>){
+        descriptions.resize(sizeof...(I)+1);
+        std::initializer_list<bool> described = {(descriptions[I+1].second = group_at<I+1, GroupT>::get(const_cast<GroupT&>(group)).describe(descriptions[I+1].first))...};
+        boost::ignore_unused(described);
+    }
+    
+    /**
+     * describes all overloads of the chain indexed by their position. 
+     * The second member of each description is false for mounted applications.
+     */
+    template <typename GroupT>
+    std::vector<std::pair<module_info, bool>> describe_overloads(const GroupT& group){
+        std::vector<std::pair<module_info, bool>> descriptions;
+        describe_overloads(group, descriptions, std::make_index_sequence<GroupT::depth>());
+        return descriptions;
+    }
+    
+    /**
+     * positions of the overloads of a chain grouped by request method in descending order of precedence.
+     * Mounted applications serve every request method and are therefore candidates for all of them.
+     */
+    struct verb_index{
+        typedef std::vector<std::size_t> candidates_type;
+        
+        std::map<boost::beast::http::verb, candidates_type> _candidates;
+        candidates_type                                     _mounts;
+        
+        /**
+         * adds the overload at position index
+         * @param callable false for mounted applications
+         */
+        void add(std::size_t index, const module_info& info, bool callable){
+            if(callable){
+                _candidates[info._method].push_back(index);
+            }else{
+                _mounts.push_back(index);
+            }
+        }
+        /**
+         * merges the mounted applications into the candidates of each request method. Must be called once after all overloads are added.
+         */
+        void seal(){
+            for(auto& candidates: _candidates){
+                candidates_type& positions = candidates.second;
+                positions.insert(positions.end(), _mounts.begin(), _mounts.end());
+                std::sort(positions.begin(), positions.end(), std::greater<std::size_t>());
+            }
+            std::sort(_mounts.begin(), _mounts.end(), std::greater<std::size_t>());
+        }
+        /**
+         * overloads that may serve a request with the given method
+         */
+        const candidates_type& candidates(boost::beast::http::verb request_method) const{
+            auto it = _candidates.find(request_method);
+            return (it != _candidates.end()) ? it->second : _mounts;
+        }
+    };
+}
+
+/**
+ * router that groups the url mappings of an overload chain by request method once, when it is built.
+ * A request is only matched against the url mappings of its own request method (and the mounted applications), 
+ * instead of walking the entire chain. Precedence is the same as of the overload chain, i.e. the url mapping attached last wins.
+ * 
+ * @code
+ * auto router = udho::indexed(udho::router()
+ *      | (udho::get(&hello).plain()  = "^/hello$")
+ *      | (udho::post(&create).json() = "^/create$"));
+ * @endcode
+ * @see radix_router
+ * @tparam GroupT the overload chain
+ * \ingroup routing
+ */
+template <typename GroupT>
+struct indexed_router: GroupT{
+    typedef GroupT                      group_type;
+    typedef indexed_router<GroupT>      self_type;
+    
+    internal::verb_index _index;
+    
+    explicit indexed_router(const group_type& group): group_type(group){
+        std::vector<std::pair<module_info, bool>> descriptions = internal::describe_overloads(static_cast<const group_type&>(*this));
+        for(std::size_t i = 1; i < descriptions.size(); ++i){
+            _index.add(i, descriptions[i].first, descriptions[i].second);
+        }
+        _index.seal();
+    }
+    template <typename ContextT, typename Lambda>
+    int serve(ContextT& ctx, boost::beast::http::verb request_method, const std::string& subject, Lambda send){
+        typedef internal::group_dispatcher<group_type, ContextT, Lambda, boost::smatch> dispatcher_type;
+        
+        group_type& group = static_cast<group_type&>(*this);
+        std::string subject_decoded = udho::util::urldecode(subject);
+        for(std::size_t index: _index.candidates(request_method)){
+            int status = 0;
+            if(dispatcher_type::attempt(index, group, ctx, request_method, subject, subject_decoded, send, status)){
+                return status;
+            }
+        }
+        return internal::group_at<0, group_type>::get(group).serve(ctx, request_method, subject, send);
+    }
+    template <typename AttachmentT>
+    self_type& listen(boost::asio::io_service& io, AttachmentT& attachment, int port=9198){
+        return listen(io, attachment, udho::endpoint::tcp4(port));
+    }
+    /**
+     * listens on an IPv4 or IPv6 endpoint or a unix domain socket
+     */
+    template <typename AttachmentT>
+    self_type& listen(boost::asio::io_service& io, AttachmentT& attachment, const udho::endpoint& endpoint){
+        udho::listen(*this, io, attachment, endpoint);
+        return *this;
+    }
+    template <typename AttachmentT>
+    self_type& listen(udho::io_pool& pool, AttachmentT& attachment, int port=9198){
+        return listen(pool, attachment, udho::endpoint::tcp4(port));
+    }
+    template <typename AttachmentT>
+    self_type& listen(udho::io_pool& pool, AttachmentT& attachment, const udho::endpoint& endpoint){
+        udho::listen(*this, pool, attachment, endpoint);
+        return *this;
+    }
+};
+
+/**
+ * groups the url mappings of an overload chain by request method
+ * @see indexed_router
+ * \ingroup routing
+ */
+template <typename U, typename V>
+indexed_router<overload_group<U, V>> indexed(const overload_group<U, V>& group){
+    return indexed_router<overload_group<U, V>>(group);
+}
+
 /**
  * \ingroup routing
  */
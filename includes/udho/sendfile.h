@@ -0,0 +1,216 @@
+/*
+ * Copyright (c) 2020, Neel Basu <neel.basu.z@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <organization> nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Neel Basu <neel.basu.z@gmail.com> ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Neel Basu <neel.basu.z@gmail.com> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef UDHO_SENDFILE_H
+#define UDHO_SENDFILE_H
+
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <functional>
+#include <boost/asio/write.hpp>
+#include <boost/asio/bind_executor.hpp>
+#include <boost/asio/associated_executor.hpp>
+#include <boost/beast/core/file.hpp>
+#include <boost/beast/http/write.hpp>
+#include <boost/beast/http/message.hpp>
+#include <boost/beast/http/serializer.hpp>
+#include <boost/beast/http/file_body.hpp>
+#include <udho/ranges.h>
+
+#if !defined(UDHO_USE_SENDFILE) && defined(__linux__) && BOOST_BEAST_USE_POSIX_FILE
+#define UDHO_USE_SENDFILE 1
+#endif
+
+#if UDHO_USE_SENDFILE
+#include <cerrno>
+#include <sys/types.h>
+#include <sys/sendfile.h>
+#endif
+
+namespace udho{
+
+namespace internal{
+
+#if UDHO_USE_SENDFILE
+
+/**
+ * a span of a file to be sent with sendfile, preceded by bytes to be written from memory
+ */
+struct sendfile_segment{
+    const char*   _head;
+    std::size_t   _head_size;
+    std::uint64_t _offset;
+    std::uint64_t _end;
+};
+
+inline bool sendfile_capable(const boost::beast::http::file_body::value_type& body){
+    return body.is_open();
+}
+inline bool sendfile_capable(const udho::ranged_file_body::value_type& body){
+    return body.is_open() && !body.content();
+}
+inline void sendfile_segments(boost::beast::http::file_body::value_type& body, std::vector<sendfile_segment>& segments){
+    segments.push_back(sendfile_segment{nullptr, 0, 0, body.size()});
+}
+inline void sendfile_segments(udho::ranged_file_body::value_type& body, std::vector<sendfile_segment>& segments){
+    for(const udho::ranged_file_body::part& part: body.parts()){
+        segments.push_back(sendfile_segment{part._head.data(), part._head.size(), part._offset, part._offset + part._length});
+    }
+    if(!body.tail().empty()){
+        segments.push_back(sendfile_segment{body.tail().data(), body.tail().size(), 0, 0});
+    }
+}
+
+/**
+ * writes the header of a file response through beast and then moves the body from the file descriptor
+ * to the socket with sendfile(2), without copying it through userspace buffers.
+ * The body is sent as a sequence of segments, e.g. the parts of a multipart/byteranges response, each of
+ * which may be preceded by a few bytes written from memory.
+ * The socket is switched to non blocking mode and the transfer waits for writability whenever the socket buffer is full.
+ */
+template <typename SocketT, typename Body, typename Fields, typename Handler>
+class sendfile_operation: public std::enable_shared_from_this<sendfile_operation<SocketT, Body, Fields, Handler>>{
+    typedef sendfile_operation<SocketT, Body, Fields, Handler>                     self_type;
+    typedef boost::beast::http::response<Body, Fields>                             response_type;
+    typedef boost::beast::http::response_serializer<Body, Fields>                  serializer_type;
+
+    enum { chunk = 1024 * 1024 }; ///< maximum number of bytes transferred by a single sendfile call
+
+    SocketT&                       _socket;
+    std::shared_ptr<response_type> _response;
+    serializer_type                _serializer;
+    Handler                        _handler;
+    std::vector<sendfile_segment>  _segments;
+    std::size_t                    _segment;
+    std::size_t                    _transferred;
+  public:
+    sendfile_operation(SocketT& socket, std::shared_ptr<response_type> response, Handler handler)
+        : _socket(socket), _response(response), _serializer(*response), _handler(std::move(handler)), _segment(0), _transferred(0){}
+    void start(){
+        sendfile_segments(_response->body(), _segments);
+        _serializer.split(true);
+        boost::beast::http::async_write_header(_socket, _serializer, bind(std::bind(&self_type::on_header, this->shared_from_this(), std::placeholders::_1, std::placeholders::_2)));
+    }
+  private:
+    template <typename F>
+    auto bind(F&& f){
+        return boost::asio::bind_executor(boost::asio::get_associated_executor(_handler, _socket.get_executor()), std::forward<F>(f));
+    }
+    void on_header(boost::beast::error_code ec, std::size_t bytes_transferred){
+        _transferred += bytes_transferred;
+        if(ec){
+            return complete(ec);
+        }
+        _socket.native_non_blocking(true, ec);
+        if(ec){
+            return complete(ec);
+        }
+        transfer();
+    }
+    void on_head(boost::beast::error_code ec, std::size_t bytes_transferred){
+        _transferred += bytes_transferred;
+        if(ec){
+            return complete(ec);
+        }
+        transfer();
+    }
+    void on_writable(boost::beast::error_code ec){
+        if(ec){
+            return complete(ec);
+        }
+        transfer();
+    }
+    void transfer(){
+        int out = _socket.native_handle();
+        int in  = _response->body().file().native_handle();
+        while(_segment < _segments.size()){
+            sendfile_segment& segment = _segments[_segment];
+            if(segment._head_size){
+                boost::asio::const_buffer head(segment._head, segment._head_size);
+                segment._head_size = 0;
+                boost::asio::async_write(_socket, head, bind(std::bind(&self_type::on_head, this->shared_from_this(), std::placeholders::_1, std::placeholders::_2)));
+                return;
+            }
+            while(segment._offset < segment._end){
+                off_t offset = static_cast<off_t>(segment._offset);
+                ssize_t sent = ::sendfile(out, in, &offset, static_cast<std::size_t>(std::min<std::uint64_t>(segment._end - segment._offset, chunk)));
+                if(sent > 0){
+                    segment._offset = static_cast<std::uint64_t>(offset);
+                    _transferred += static_cast<std::size_t>(sent);
+                }else if(sent == 0){
+                    // the file has been truncated after its size was read
+                    return complete(boost::asio::error::eof);
+                }else if(errno == EINTR){
+                    continue;
+                }else if(errno == EAGAIN || errno == EWOULDBLOCK){
+                    _socket.async_wait(SocketT::wait_write, bind(std::bind(&self_type::on_writable, this->shared_from_this(), std::placeholders::_1)));
+                    return;
+                }else{
+                    return complete(boost::beast::error_code(errno, boost::system::system_category()));
+                }
+            }
+            ++_segment;
+        }
+        complete(boost::beast::error_code());
+    }
+    void complete(boost::beast::error_code ec){
+        _handler(ec, _transferred);
+    }
+};
+
+#endif
+
+}
+
+/**
+ * asynchronously writes a response with a file_body or a ranged_file_body to the socket. On linux the body is transferred using sendfile(2),
+ * otherwise it falls back to boost::beast::http::async_write. The response must be kept alive by the caller until the handler is called.
+ *
+ * @param socket the socket to write to
+ * @param response the response to write
+ * @param handler called as `handler(error_code, bytes_transferred)` on completion
+ * \ingroup server
+ */
+template <typename SocketT, typename Body, typename Fields, typename Handler>
+void async_write_file(SocketT& socket, std::shared_ptr<boost::beast::http::response<Body, Fields>> response, Handler handler){
+    if(!response->has_content_length() && !response->chunked()){
+        response->prepare_payload();
+    }
+#if UDHO_USE_SENDFILE
+    if(!response->chunked() && internal::sendfile_capable(response->body())){
+        typedef internal::sendfile_operation<SocketT, Body, Fields, Handler> operation_type;
+        std::make_shared<operation_type>(socket, response, std::move(handler))->start();
+        return;
+    }
+#endif
+    boost::beast::http::async_write(socket, *response, std::move(handler));
+}
+
+}
+
+#endif // UDHO_SENDFILE_H
@@ -37,6 +37,9 @@
 #include <udho/attachment.h>
 #include <udho/bridge.h>
 #include <udho/configuration.h>
+#include <udho/io_pool.h>
+#include <udho/endpoint.h>
+#include <vector>
 
 namespace udho{
 
@@ -75,6 +78,62 @@ struct server{
 #endif
         router.template listen<attachment_type>(_io, _attachment, port);
     }
+    /**
+     * serves the router on all io_contexts of the pool, each having its own SO_REUSEPORT acceptor on the same port
+     */
+    template <typename RouterT>
+    void serve(RouterT&& router, udho::io_pool& pool, int port=9198){
+#ifdef WITH_ICU
+        _attachment << udho::logging::messages::formatted::info("server", "server (-with-icu) started on port %1% using %2% threads") % port % pool.size();
+#else
+        _attachment << udho::logging::messages::formatted::info("server", "server started on port %1% using %2% threads") % port % pool.size();
+#endif
+        router.template listen<attachment_type>(pool, _attachment, port);
+    }
+    /**
+     * serves the router on each of the endpoints, which may be IPv4 or IPv6 addresses and unix domain sockets
+     * @code
+     * server.serve(router, {udho::endpoint::tcp4(9198).nodelay(), udho::endpoint::local("/run/app/http.sock", 0660)});
+     * @endcode
+     */
+    template <typename RouterT>
+    void serve(RouterT&& router, const std::vector<udho::endpoint>& endpoints){
+        for(const udho::endpoint& endpoint: endpoints){
+#ifdef WITH_ICU
+            _attachment << udho::logging::messages::formatted::info("server", "server (-with-icu) started on %1%") % endpoint.str();
+#else
+            _attachment << udho::logging::messages::formatted::info("server", "server started on %1%") % endpoint.str();
+#endif
+            router.template listen<attachment_type>(_io, _attachment, endpoint);
+        }
+    }
+    /**
+     * serves the router on each of the endpoints with all io_contexts of the pool
+     */
+    template <typename RouterT>
+    void serve(RouterT&& router, udho::io_pool& pool, const std::vector<udho::endpoint>& endpoints){
+        for(const udho::endpoint& endpoint: endpoints){
+#ifdef WITH_ICU
+            _attachment << udho::logging::messages::formatted::info("server", "server (-with-icu) started on %1% using %2% threads") % endpoint.str() % pool.size();
+#else
+            _attachment << udho::logging::messages::formatted::info("server", "server started on %1% using %2% threads") % endpoint.str() % pool.size();
+#endif
+            router.template listen<attachment_type>(pool, _attachment, endpoint);
+        }
+    }
+    /**
+     * shuts down gracefully as on SIGINT or SIGTERM: stops accepting, closes the idle connections, answers the in-flight requests with Connection: close
+     * and stops the io_contexts once all connections have closed or `udho::configs::timeouts::drain` has passed
+     */
+    void drain(){
+        _attachment.aux().connections().drain();
+    }
+    /**
+     * number of connections that are open now
+     */
+    std::size_t live(){
+        return _attachment.aux().connections().live();
+    }
     template <typename FeatureT>
     auto operator+=(const FeatureT& feature){
         return (_attachment += feature);
@@ -127,6 +186,62 @@ struct server<AuxT, void, CacheT>{
 #endif
         router.template listen<attachment_type>(_io, _attachment, port);
     }
+    /**
+     * serves the router on all io_contexts of the pool, each having its own SO_REUSEPORT acceptor on the same port
+     */
+    template <typename RouterT>
+    void serve(RouterT&& router, udho::io_pool& pool, int port=9198){
+#ifdef WITH_ICU
+        _attachment << udho::logging::messages::formatted::info("server", "server (-with-icu) started on port %1% using %2% threads") % port % pool.size();
+#else
+        _attachment << udho::logging::messages::formatted::info("server", "server started on port %1% using %2% threads") % port % pool.size();
+#endif
+        router.template listen<attachment_type>(pool, _attachment, port);
+    }
+    /**
+     * serves the router on each of the endpoints, which may be IPv4 or IPv6 addresses and unix domain sockets
+     * @code
+     * server.serve(router, {udho::endpoint::tcp4(9198).nodelay(), udho::endpoint::local("/run/app/http.sock", 0660)});
+     * @endcode
+     */
+    template <typename RouterT>
+    void serve(RouterT&& router, const std::vector<udho::endpoint>& endpoints){
+        for(const udho::endpoint& endpoint: endpoints){
+#ifdef WITH_ICU
+            _attachment << udho::logging::messages::formatted::info("server", "server (-with-icu) started on %1%") % endpoint.str();
+#else
+            _attachment << udho::logging::messages::formatted::info("server", "server started on %1%") % endpoint.str();
+#endif
+            router.template listen<attachment_type>(_io, _attachment, endpoint);
+        }
+    }
+    /**
+     * serves the router on each of the endpoints with all io_contexts of the pool
+     */
+    template <typename RouterT>
+    void serve(RouterT&& router, udho::io_pool& pool, const std::vector<udho::endpoint>& endpoints){
+        for(const udho::endpoint& endpoint: endpoints){
+#ifdef WITH_ICU
+            _attachment << udho::logging::messages::formatted::info("server", "server (-with-icu) started on %1% using %2% threads") % endpoint.str() % pool.size();
+#else
+            _attachment << udho::logging::messages::formatted::info("server", "server started on %1% using %2% threads") % endpoint.str() % pool.size();
+#endif
+            router.template listen<attachment_type>(pool, _attachment, endpoint);
+        }
+    }
+    /**
+     * shuts down gracefully as on SIGINT or SIGTERM: stops accepting, closes the idle connections, answers the in-flight requests with Connection: close
+     * and stops the io_contexts once all connections have closed or `udho::configs::timeouts::drain` has passed
+     */
+    void drain(){
+        _attachment.aux().connections().drain();
+    }
+    /**
+     * number of connections that are open now
+     */
+    std::size_t live(){
+        return _attachment.aux().connections().live();
+    }
     template <typename FeatureT>
     auto operator+=(const FeatureT& feature){
         return (_attachment += feature);
@@ -242,6 +357,24 @@ namespace ostreamed{
         void serve(RouterT&& router, int port=9198){
             _server.template serve(router, port);
         }
+        template <typename RouterT>
+        void serve(RouterT&& router, udho::io_pool& pool, int port=9198){
+            _server.template serve(router, pool, port);
+        }
+        template <typename RouterT>
+        void serve(RouterT&& router, const std::vector<udho::endpoint>& endpoints){
+            _server.template serve(router, endpoints);
+        }
+        template <typename RouterT>
+        void serve(RouterT&& router, udho::io_pool& pool, const std::vector<udho::endpoint>& endpoints){
+            _server.template serve(router, pool, endpoints);
+        }
+        void drain(){
+            _server.drain();
+        }
+        std::size_t live(){
+            return _server.live();
+        }
         template <typename FeatureT>
         auto operator+=(const FeatureT& feature){
             return (_server += feature);
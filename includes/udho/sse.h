@@ -0,0 +1,318 @@
+/*
+ * Copyright (c) 2020, Neel Basu <neel.basu.z@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <organization> nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Neel Basu <neel.basu.z@gmail.com> ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Neel Basu <neel.basu.z@gmail.com> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef UDHO_SSE_H
+#define UDHO_SSE_H
+
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <boost/asio/post.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/beast/http/field.hpp>
+#include <boost/beast/http/status.hpp>
+#include <udho/stream.h>
+
+namespace udho{
+    
+namespace sse{
+
+/**
+ * an event serialized once in the text/event-stream format and shared by all subscribers it is sent to
+ * @code
+ * udho::sse::event update("{\"cpu\": 42}", "load", "17");
+ * @endcode
+ * \ingroup server
+ */
+class event{
+    std::shared_ptr<const std::string> _buffer;
+    
+    explicit event(std::shared_ptr<const std::string> buffer): _buffer(buffer){}
+  public:
+    /**
+     * @param data payload, sent as one data field per line
+     * @param name type of the event, dispatched to the listeners of that name by an EventSource. Empty for message.
+     * @param id id of the event, sent back by the EventSource in the Last-Event-ID header when it reconnects
+     * @param retry reconnection delay for the EventSource, 0 to leave it unchanged
+     */
+    explicit event(const std::string& data, const std::string& name = "", const std::string& id = "", std::chrono::milliseconds retry = std::chrono::milliseconds(0)){
+        std::string buffer;
+        buffer.reserve(data.size() + name.size() + id.size() + 32);
+        if(!id.empty()){
+            buffer += "id: " + id + "\n";
+        }
+        if(!name.empty()){
+            buffer += "event: " + name + "\n";
+        }
+        if(retry.count() > 0){
+            buffer += "retry: " + std::to_string(retry.count()) + "\n";
+        }
+        std::string::size_type begin = 0;
+        do{
+            std::string::size_type end = data.find('\n', begin);
+            std::string line = data.substr(begin, end == std::string::npos ? std::string::npos : end - begin);
+            if(!line.empty() && line.back() == '\r'){
+                line.pop_back();
+            }
+            buffer += "data: " + line + "\n";
+            begin = (end == std::string::npos) ? std::string::npos : end + 1;
+        }while(begin != std::string::npos);
+        buffer += "\n";
+        _buffer = std::make_shared<const std::string>(std::move(buffer));
+    }
+    /**
+     * a comment line, ignored by the EventSource, e.g. to keep idle connections alive through proxies
+     */
+    static event comment(const std::string& text = ""){
+        return event(std::make_shared<const std::string>(": " + text + "\n\n"));
+    }
+    std::shared_ptr<const std::string> buffer() const{
+        return _buffer;
+    }
+    const std::string& str() const{
+        return *_buffer;
+    }
+};
+
+/**
+ * subscribers of server sent events grouped by key, keyed like udho::watcher so that long polling watches can be moved to events.
+ * Where a long poll releases the watches of a key on notify and the clients reconnect, notify here sends an event to the subscribers
+ * of the key over their open streams. One serialized buffer is shared by all subscribers of an event.
+ * A subscriber whose connection fails is removed, a subscriber that falls behind by more than the backlog is dropped, which aborts its connection.
+ * The hub must outlive the streams subscribed to it. All methods may be called from any thread.
+ * @code
+ * udho::sse::hub<std::string> dashboards;
+ * std::string board(context_type ctx, std::string name){ return name; }
+ * auto router = udho::router() | (udho::get(&board).sse(dashboards) = "^/events/(\\w+)$");
+ * dashboards.notify("sales", udho::sse::event("{\"total\": 42}", "update"));
+ * @endcode
+ * \ingroup server
+ */
+template <typename KeyT = std::string>
+class hub{
+  public:
+    typedef KeyT key_type;
+  private:
+    struct subscriber{
+        key_type                 _key;
+        udho::stream             _stream;
+        std::atomic<std::size_t> _pending;
+        
+        subscriber(const key_type& key, udho::stream stream): _key(key), _stream(stream), _pending(0){}
+    };
+    typedef std::shared_ptr<subscriber>                      subscriber_ptr;
+    typedef std::multimap<key_type, subscriber_ptr>          index_type;
+    
+    index_type         _index;
+    std::size_t        _backlog;
+    mutable std::mutex _mutex;
+  public:
+    /**
+     * @param backlog number of events of a subscriber that may be waiting to be written before the subscriber is dropped
+     */
+    explicit hub(std::size_t backlog = 64): _backlog(backlog){}
+    hub(const hub&) = delete;
+    hub& operator=(const hub&) = delete;
+    /**
+     * subscribes an open stream to the events of key
+     */
+    void subscribe(const key_type& key, udho::stream stream){
+        std::lock_guard<std::mutex> lock(_mutex);
+        _index.insert(std::make_pair(key, std::make_shared<subscriber>(key, stream)));
+    }
+    /**
+     * sends the event to the subscribers of key
+     * @return number of subscribers the event has been sent to
+     */
+    std::size_t notify(const key_type& key, const event& e){
+        std::vector<subscriber_ptr> subscribers;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            auto range = _index.equal_range(key);
+            for(auto i = range.first; i != range.second; ++i){
+                subscribers.push_back(i->second);
+            }
+        }
+        return send(subscribers, e);
+    }
+    /**
+     * sends the event to all subscribers
+     * @return number of subscribers the event has been sent to
+     */
+    std::size_t notify_all(const event& e){
+        return send(subscribers(), e);
+    }
+    /**
+     * sends a comment to all subscribers, keeping idle connections alive and removing the subscribers whose connections have failed
+     */
+    std::size_t heartbeat(){
+        return notify_all(event::comment());
+    }
+    /**
+     * finishes the streams of the subscribers of key, which end their responses
+     */
+    std::size_t close(const key_type& key){
+        std::vector<subscriber_ptr> closed;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            auto range = _index.equal_range(key);
+            for(auto i = range.first; i != range.second; ++i){
+                closed.push_back(i->second);
+            }
+            _index.erase(range.first, range.second);
+        }
+        for(const subscriber_ptr& s: closed){
+            s->_stream.finish();
+        }
+        return closed.size();
+    }
+    /**
+     * finishes the streams of all subscribers
+     */
+    std::size_t close_all(){
+        index_type closed;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            closed.swap(_index);
+        }
+        for(const auto& i: closed){
+            i.second->_stream.finish();
+        }
+        return closed.size();
+    }
+    /**
+     * number of subscribers of key
+     */
+    std::size_t count(const key_type& key) const{
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _index.count(key);
+    }
+    /**
+     * number of subscribers
+     */
+    std::size_t size() const{
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _index.size();
+    }
+    void async_notify(boost::asio::io_context& io, const key_type& key, const event& e){
+        boost::asio::post(io, [this, key, e](){
+            notify(key, e);
+        });
+    }
+    void async_notify_all(boost::asio::io_context& io, const event& e){
+        boost::asio::post(io, [this, e](){
+            notify_all(e);
+        });
+    }
+  private:
+    std::vector<subscriber_ptr> subscribers() const{
+        std::vector<subscriber_ptr> all;
+        std::lock_guard<std::mutex> lock(_mutex);
+        all.reserve(_index.size());
+        for(const auto& i: _index){
+            all.push_back(i.second);
+        }
+        return all;
+    }
+    std::size_t send(const std::vector<subscriber_ptr>& subscribers, const event& e){
+        std::size_t sent = 0;
+        for(const subscriber_ptr& s: subscribers){
+            if(s->_pending.fetch_add(1) >= _backlog){
+                remove(s);
+                continue;
+            }
+            std::weak_ptr<subscriber> weak = s;
+            s->_stream.write(e.buffer(), [this, weak](const boost::system::error_code& ec){
+                subscriber_ptr s = weak.lock();
+                if(!s){
+                    return;
+                }
+                s->_pending.fetch_sub(1);
+                if(ec){
+                    remove(s);
+                }
+            });
+            ++sent;
+        }
+        return sent;
+    }
+    /**
+     * removes the subscriber, dropping its stream unfinished once the pending writes release it
+     */
+    void remove(const subscriber_ptr& s){
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto range = _index.equal_range(s->_key);
+        for(auto i = range.first; i != range.second; ++i){
+            if(i->second == s){
+                _index.erase(i);
+                break;
+            }
+        }
+    }
+};
+
+}
+
+namespace compositors{
+    
+    /**
+     * \ingroup routing.content
+     * keeps the connection open as a text/event-stream and subscribes it to the key returned by the callback e.g. `udho::get(f).sse(hub)`
+     * \see udho::sse::hub
+     */
+    template <typename OutputT>
+    struct sse{
+        typedef void response_type;
+        typedef udho::sse::hub<OutputT> hub_type;
+        
+        hub_type* _hub;
+        
+        sse(): _hub(0x0){}
+        explicit sse(hub_type& hub): _hub(&hub){}
+        template <typename ContextT>
+        void operator()(ContextT& ctx, const OutputT& key){
+            udho::stream::header_type header{boost::beast::http::status::ok, ctx.request().version()};
+            header.set(boost::beast::http::field::content_type, "text/event-stream");
+            header.set(boost::beast::http::field::cache_control, "no-cache");
+            udho::stream stream = ctx.stream(std::move(header));
+            _hub->subscribe(key, stream);
+        }
+        std::string name() const{
+            return "SSE";
+        }
+    };
+    
+}
+
+}
+
+#endif // UDHO_SSE_H
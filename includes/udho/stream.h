@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2020, Neel Basu <neel.basu.z@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <organization> nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Neel Basu <neel.basu.z@gmail.com> ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Neel Basu <neel.basu.z@gmail.com> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef UDHO_STREAM_H
+#define UDHO_STREAM_H
+
+#include <memory>
+#include <string>
+#include <functional>
+#include <boost/asio/error.hpp>
+#include <boost/system/error_code.hpp>
+#include <boost/beast/http/message.hpp>
+#include <boost/beast/http/empty_body.hpp>
+
+namespace udho{
+
+/**
+ * response of a deferred request whose body is sent in chunks as it is produced, instead of being composed in memory.
+ * The headers are sent as soon as the earlier responses of the connection have been written, the body is sent with
+ * `Transfer-Encoding: chunked` (or until the connection closes for HTTP/1.0 clients). Each chunk takes a completion
+ * handler that is called on the io thread once the chunk has been written, so the next chunk can be produced only when
+ * the client keeps up. The write timeout (udho::configs::timeouts::write) applies to each chunk being written, not to the wait for the next one.
+ * A stream dropped without finish() aborts the connection so that the client notices the truncated body.
+ * @code
+ * void export_csv(context_type ctx){
+ *     udho::stream out = ctx.stream("text/csv");
+ *     auto row = std::make_shared<std::function<void (const boost::system::error_code&)>>();
+ *     auto index = std::make_shared<int>(0);
+ *     *row = [out, row, index](const boost::system::error_code& ec) mutable {
+ *         if(ec) return;
+ *         if(*index == 1000) return out.finish();
+ *         out.write(std::to_string((*index)++) + "\n", *row);
+ *     };
+ *     (*row)(boost::system::error_code());
+ * }
+ * @endcode
+ * The methods may be called from any thread.
+ * \ingroup server
+ */
+class stream{
+  public:
+    typedef std::function<void (const boost::system::error_code&)>                 handler_type;
+    typedef boost::beast::http::response<boost::beast::http::empty_body>           header_type;
+    
+    /**
+     * connection side of a stream
+     */
+    struct channel{
+        virtual void write(std::shared_ptr<const std::string> chunk, handler_type handler) = 0;
+        virtual void finish(handler_type handler) = 0;
+        virtual ~channel(){}
+    };
+  private:
+    header_type              _header;
+    std::shared_ptr<channel> _channel;
+  public:
+    stream(){}
+    explicit stream(header_type header): _header(std::move(header)){}
+    /**
+     * headers of the response, which are sent when the stream is attached to its connection
+     */
+    const header_type& header() const{
+        return _header;
+    }
+    void attach(std::shared_ptr<channel> chan){
+        _channel = chan;
+    }
+    /**
+     * whether the stream is attached to a connection
+     */
+    bool open() const{
+        return !!_channel;
+    }
+    /**
+     * sends a chunk of the body. An empty chunk is not sent.
+     * @param handler called with the error, if any, once the chunk has been written
+     */
+    void write(std::string chunk, handler_type handler = handler_type()){
+        write(std::make_shared<const std::string>(std::move(chunk)), handler);
+    }
+    /**
+     * sends a chunk that is shared with other streams e.g. an event broadcasted to many subscribers, without copying it
+     */
+    void write(std::shared_ptr<const std::string> chunk, handler_type handler = handler_type()){
+        if(!_channel){
+            return fail(handler);
+        }
+        _channel->write(chunk, handler);
+    }
+    /**
+     * ends the body
+     * @param handler called once the last chunk has been written
+     */
+    void finish(handler_type handler = handler_type()){
+        if(!_channel){
+            return fail(handler);
+        }
+        _channel->finish(handler);
+    }
+  private:
+    static void fail(handler_type& handler){
+        if(handler){
+            handler(boost::asio::error::not_connected);
+        }
+    }
+};
+
+}
+
+#endif // UDHO_STREAM_H
@@ -5,6 +5,9 @@
 #include <vector>
 #include <sstream>
 #include <iostream>
+#include <ctime>
+#include <iomanip>
+#include <locale>
 #include <boost/regex.hpp>
 #include <boost/format.hpp>
 #include <boost/function.hpp>
@@ -150,22 +153,62 @@ namespace internal{
     
 namespace internal{
 //     std::string path_cat(boost::beast::string_view base, boost::beast::string_view path);
+    /**
+     * joins a request path to a base directory, which is expected to be canonical (see udho::path_cache::root)
+     */
     inline boost::filesystem::path path_cat(const boost::filesystem::path& base, const std::string& path){
-        return (boost::filesystem::canonical(base) / boost::filesystem::path(path).make_preferred());
+        return (base / boost::filesystem::path(path).make_preferred());
     }
+    /**
+     * whether the path is lexically inside the base directory after resolving the `.` and `..` segments of the path.
+     * Paths are compared segment wise, so that /srv/www2 is not inside /srv/www.
+     */
     inline bool path_inside(const boost::filesystem::path& base, const boost::filesystem::path& path){
-        std::string left = base.string(), right = path.string();
-        std::string::const_iterator lit = left.cbegin(), rit = right.cbegin();
-        std::size_t matched = 0;
-        while(lit != left.cend() && rit != right.cend()){
-            if(*lit != *rit){
-                break;
+        boost::filesystem::path left = base.lexically_normal(), right = path.lexically_normal();
+        boost::filesystem::path::const_iterator lit = left.begin(), rit = right.begin();
+        for(; lit != left.end(); ++lit){
+            if(lit->empty() || *lit == "."){
+                continue;
+            }
+            while(rit != right.end() && (rit->empty() || *rit == ".")){
+                ++rit;
+            }
+            if(rit == right.end() || *lit != *rit){
+                return false;
             }
-            ++matched;
-            ++lit;
             ++rit;
         }
-        return matched >= left.size();
+        for(; rit != right.end(); ++rit){
+            if(*rit == ".."){
+                return false;
+            }
+        }
+        return true;
+    }
+    /**
+     * formats a time as an HTTP date e.g. `Sun, 06 Nov 1994 08:49:37 GMT`
+     */
+    inline std::string http_date(std::time_t time){
+        std::tm tm;
+        gmtime_r(&time, &tm);
+        char buffer[32];
+        std::size_t length = std::strftime(buffer, sizeof(buffer), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+        return std::string(buffer, length);
+    }
+    /**
+     * parses an HTTP date in the preferred IMF-fixdate format
+     * @return false if the date is malformed
+     */
+    inline bool parse_http_date(const std::string& text, std::time_t& time){
+        std::tm tm = {};
+        std::istringstream stream(text);
+        stream.imbue(std::locale::classic());
+        stream >> std::get_time(&tm, "%a, %d %b %Y %H:%M:%S GMT");
+        if(stream.fail()){
+            return false;
+        }
+        time = timegm(&tm);
+        return true;
     }
 }
 
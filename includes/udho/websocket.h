@@ -0,0 +1,404 @@
+/*
+ * Copyright (c) 2020, Neel Basu <neel.basu.z@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <organization> nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Neel Basu <neel.basu.z@gmail.com> ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Neel Basu <neel.basu.z@gmail.com> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef UDHO_WEBSOCKET_H
+#define UDHO_WEBSOCKET_H
+
+#include <deque>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+#include <boost/asio/post.hpp>
+#include <boost/asio/dispatch.hpp>
+#include <boost/asio/bind_executor.hpp>
+#include <boost/beast/core/flat_buffer.hpp>
+#include <boost/beast/core/buffers_to_string.hpp>
+#include <boost/beast/http/message.hpp>
+#include <boost/beast/http/empty_body.hpp>
+#include <boost/beast/websocket.hpp>
+#include <udho/defs.h>
+#include <udho/headers.h>
+
+namespace udho{
+    
+namespace websocket{
+    
+typedef std::function<void (const boost::system::error_code&)> handler_type;
+
+/**
+ * websocket side of a peer, implemented by the session
+ */
+struct channel{
+    virtual bool send(std::shared_ptr<const std::string> message, bool binary, handler_type handler) = 0;
+    virtual void close(std::uint16_t code, const std::string& reason) = 0;
+    virtual std::size_t queued() const = 0;
+    virtual ~channel(){}
+};
+
+/**
+ * the remote end of an upgraded connection, cheap to copy and safe to use from any thread.
+ * A peer does not keep its connection alive, the methods of a peer of a closed connection fail.
+ * \ingroup server
+ */
+class peer{
+    std::weak_ptr<channel> _channel;
+  public:
+    peer(){}
+    explicit peer(std::weak_ptr<channel> chan): _channel(chan){}
+    /**
+     * queues a text message unless the outgoing queue is full
+     * @param handler called on the strand of the connection once the message has been written
+     * @return false if the connection is closed or too many messages are waiting to be written
+     */
+    bool send(std::string message, handler_type handler = handler_type()){
+        return send(std::make_shared<const std::string>(std::move(message)), false, handler);
+    }
+    /**
+     * queues a text or binary message that may be shared with other peers
+     */
+    bool send(std::shared_ptr<const std::string> message, bool binary, handler_type handler = handler_type()){
+        std::shared_ptr<channel> chan = _channel.lock();
+        return chan && chan->send(message, binary, handler);
+    }
+    /**
+     * closes the connection once the queued messages have been written
+     */
+    void close(std::uint16_t code = boost::beast::websocket::close_code::normal, const std::string& reason = ""){
+        std::shared_ptr<channel> chan = _channel.lock();
+        if(chan){
+            chan->close(code, reason);
+        }
+    }
+    /**
+     * number of messages waiting to be written
+     */
+    std::size_t queued() const{
+        std::shared_ptr<channel> chan = _channel.lock();
+        return chan ? chan->queued() : 0;
+    }
+    bool open() const{
+        return !_channel.expired();
+    }
+};
+
+/**
+ * callbacks of an upgraded connection, all called on the strand of the connection
+ * @code
+ * udho::websocket::handlers echo(context_type ctx){
+ *     return udho::websocket::handlers().on_message([](udho::websocket::peer peer, const std::string& message, bool){
+ *         peer.send(message);
+ *     });
+ * }
+ * auto router = udho::router() | (udho::get(&echo).websocket() = "^/echo$");
+ * @endcode
+ * \ingroup server
+ */
+struct handlers{
+    std::function<void (peer)>                                  _open;
+    std::function<void (peer, const std::string&, bool)>        _message;
+    std::function<void (const boost::system::error_code&)>      _close;
+    
+    /**
+     * called once the handshake has completed
+     */
+    handlers& on_open(std::function<void (peer)> f){
+        _open = f;
+        return *this;
+    }
+    /**
+     * called with every received message and whether it is binary
+     */
+    handlers& on_message(std::function<void (peer, const std::string&, bool)> f){
+        _message = f;
+        return *this;
+    }
+    /**
+     * called once when the connection closes, with websocket::error::closed if the close was clean
+     */
+    handlers& on_close(std::function<void (const boost::system::error_code&)> f){
+        _close = f;
+        return *this;
+    }
+};
+
+/**
+ * options of the websocket connections of a route e.g. `udho::get(f).websocket(udho::websocket::options().deflate())`
+ * \ingroup server
+ */
+struct options{
+    bool        _deflate;
+    std::size_t _queue;
+    std::size_t _limit;
+    
+    options(): _deflate(false), _queue(64), _limit(16 * 1024 * 1024){}
+    /**
+     * negotiate the permessage-deflate extension with the clients that offer it
+     */
+    options& deflate(bool flag = true){
+        _deflate = flag;
+        return *this;
+    }
+    /**
+     * maximum number of outgoing messages waiting to be written, further sends fail until the queue drains
+     */
+    options& queue(std::size_t size){
+        _queue = size;
+        return *this;
+    }
+    /**
+     * maximum size of an incoming message, a larger message closes the connection
+     */
+    options& limit(std::size_t size){
+        _limit = size;
+        return *this;
+    }
+};
+
+/**
+ * an upgrade requested by the route of a request, handed over to the connection
+ */
+struct upgrade{
+    typedef boost::beast::http::response<boost::beast::http::empty_body> header_type;
+    
+    websocket::handlers _handlers;
+    websocket::options  _options;
+    header_type         _header; ///< headers and cookies set through the context, sent along with 101 Switching Protocols
+};
+
+/**
+ * a websocket connection taken over from a http connection after its upgrade request
+ * @tparam SocketT socket of the http connection
+ * @tparam StrandT strand of the http connection, on which the handlers are called
+ */
+template <typename SocketT, typename StrandT>
+class session: public channel, public std::enable_shared_from_this<session<SocketT, StrandT>>{
+    typedef session<SocketT, StrandT> self_type;
+    
+    struct outgoing{
+        std::shared_ptr<const std::string> _data;
+        bool                               _binary;
+        handler_type                       _handler;
+    };
+    
+    boost::beast::websocket::stream<SocketT> _ws;
+    StrandT                                  _strand;
+    udho::defs::request_type                 _req;
+    websocket::upgrade                       _upgrade;
+    boost::beast::flat_buffer                _buffer;
+    std::deque<outgoing>                     _outgoing;
+    std::atomic<std::size_t>                 _queued;
+    bool                                     _open;
+    bool                                     _writing;
+    bool                                     _closing;
+    bool                                     _ended;
+    boost::beast::websocket::close_reason    _reason;
+  public:
+    session(SocketT&& socket, StrandT strand, const udho::defs::request_type& req, const websocket::upgrade& up): _ws(std::move(socket)), _strand(strand), _req(req), _upgrade(up), _queued(0), _open(false), _writing(false), _closing(false), _ended(false){}
+    /**
+     * responds to the upgrade request with 101 Switching Protocols and starts reading messages
+     */
+    void run(){
+        boost::beast::websocket::permessage_deflate deflate;
+        deflate.server_enable = _upgrade._options._deflate;
+        _ws.set_option(deflate);
+        _ws.set_option(boost::beast::websocket::stream_base::timeout::suggested(boost::beast::role_type::server));
+        _ws.read_message_max(_upgrade._options._limit);
+        std::shared_ptr<websocket::upgrade::header_type> header = std::make_shared<websocket::upgrade::header_type>(_upgrade._header);
+        _ws.set_option(boost::beast::websocket::stream_base::decorator([header](boost::beast::websocket::response_type& res){
+            for(const auto& field: *header){
+                res.insert(field.name_string(), field.value());
+            }
+            udho::headers::stamp(res);
+        }));
+        _ws.async_accept(_req, boost::asio::bind_executor(_strand, std::bind(&self_type::on_accept, this->shared_from_this(), std::placeholders::_1)));
+    }
+    bool send(std::shared_ptr<const std::string> message, bool binary, handler_type handler) override{
+        std::size_t queued = _queued.load(std::memory_order_relaxed);
+        do{
+            if(queued >= _upgrade._options._queue){
+                return false;
+            }
+        }while(!_queued.compare_exchange_weak(queued, queued+1, std::memory_order_relaxed));
+        boost::asio::dispatch(_strand, std::bind(&self_type::push, this->shared_from_this(), outgoing{message, binary, handler}));
+        return true;
+    }
+    void close(std::uint16_t code, const std::string& reason) override{
+        boost::asio::dispatch(_strand, std::bind(&self_type::shutdown, this->shared_from_this(), boost::beast::websocket::close_reason(static_cast<boost::beast::websocket::close_code>(code), reason.substr(0, 123))));
+    }
+    std::size_t queued() const override{
+        return _queued.load(std::memory_order_relaxed);
+    }
+  private:
+    websocket::peer remote(){
+        return websocket::peer(std::weak_ptr<channel>(this->shared_from_this()));
+    }
+    void on_accept(boost::system::error_code ec){
+        if(ec){
+            return ended(ec);
+        }
+        _open = true;
+        if(_upgrade._handlers._open){
+            _upgrade._handlers._open(remote());
+        }
+        read();
+    }
+    void read(){
+        _ws.async_read(_buffer, boost::asio::bind_executor(_strand, std::bind(&self_type::on_read, this->shared_from_this(), std::placeholders::_1, std::placeholders::_2)));
+    }
+    void on_read(boost::system::error_code ec, std::size_t /*bytes_transferred*/){
+        if(ec){
+            return ended(ec);
+        }
+        std::string message = boost::beast::buffers_to_string(_buffer.data());
+        _buffer.consume(_buffer.size());
+        if(_upgrade._handlers._message){
+            _upgrade._handlers._message(remote(), message, !_ws.got_text());
+        }
+        read();
+    }
+    void push(outgoing message){
+        if(!_open || _closing){
+            _queued.fetch_sub(1, std::memory_order_relaxed);
+            if(message._handler){
+                message._handler(boost::asio::error::operation_aborted);
+            }
+            return;
+        }
+        _outgoing.push_back(message);
+        flush();
+    }
+    /**
+     * writes the next queued message, and the close frame once all queued messages have been written
+     */
+    void flush(){
+        if(_writing || !_open){
+            return;
+        }
+        if(_outgoing.empty()){
+            if(_closing){
+                _writing = true;
+                _ws.async_close(_reason, boost::asio::bind_executor(_strand, std::bind(&self_type::on_close, this->shared_from_this(), std::placeholders::_1)));
+            }
+            return;
+        }
+        _writing = true;
+        const outgoing& message = _outgoing.front();
+        _ws.binary(message._binary);
+        _ws.async_write(boost::asio::buffer(*message._data), boost::asio::bind_executor(_strand, std::bind(&self_type::on_write, this->shared_from_this(), std::placeholders::_1, std::placeholders::_2)));
+    }
+    void on_write(boost::system::error_code ec, std::size_t /*bytes_transferred*/){
+        _writing = false;
+        if(_outgoing.empty()){
+            return;
+        }
+        outgoing message = std::move(_outgoing.front());
+        _outgoing.pop_front();
+        _queued.fetch_sub(1, std::memory_order_relaxed);
+        if(message._handler){
+            message._handler(ec);
+        }
+        if(!ec){
+            flush();
+        }
+    }
+    void shutdown(boost::beast::websocket::close_reason reason){
+        if(_closing){
+            return;
+        }
+        _closing = true;
+        _reason  = reason;
+        flush();
+    }
+    void on_close(boost::system::error_code /*ec*/){
+        // the read loop ends once the peer acknowledges the close
+    }
+    /**
+     * the connection is closed, the queued messages that are not being written are aborted
+     */
+    void ended(boost::system::error_code ec){
+        if(_ended){
+            return;
+        }
+        _ended = true;
+        _open  = false;
+        // the message being written is released by on_write
+        std::deque<outgoing> pending;
+        pending.swap(_outgoing);
+        if(_writing && !pending.empty()){
+            _outgoing.push_back(std::move(pending.front()));
+            pending.pop_front();
+        }
+        for(outgoing& message: pending){
+            _queued.fetch_sub(1, std::memory_order_relaxed);
+            if(message._handler){
+                message._handler(boost::asio::error::operation_aborted);
+            }
+        }
+        if(_upgrade._handlers._close){
+            _upgrade._handlers._close(ec);
+        }
+    }
+};
+
+}
+
+namespace compositors{
+    
+    /**
+     * \ingroup routing.content
+     * upgrades the connection to a websocket with the handlers returned by the callback e.g. `udho::get(f).websocket()`.
+     * A request to the route that does not ask for an upgrade is answered with 426 Upgrade Required.
+     * \see udho::websocket::handlers
+     */
+    template <typename OutputT>
+    struct websocket{
+        typedef void response_type;
+        
+        static_assert(std::is_same<OutputT, udho::websocket::handlers>::value, "a websocket callback must return udho::websocket::handlers");
+        
+        udho::websocket::options _options;
+        
+        websocket(){}
+        explicit websocket(const udho::websocket::options& options): _options(options){}
+        template <typename ContextT>
+        void operator()(ContextT& ctx, const OutputT& handlers){
+            ctx.upgrade(handlers, _options);
+        }
+        std::string name() const{
+            return "WEBSOCKET";
+        }
+    };
+    
+}
+
+}
+
+#endif // UDHO_WEBSOCKET_H
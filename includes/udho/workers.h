@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) 2020, Neel Basu <neel.basu.z@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <organization> nor the
+ *     names of its contributors may be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Neel Basu <neel.basu.z@gmail.com> ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL Neel Basu <neel.basu.z@gmail.com> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef UDHO_WORKERS_H
+#define UDHO_WORKERS_H
+
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <cstdint>
+#include <functional>
+#include <boost/asio/post.hpp>
+#include <boost/asio/thread_pool.hpp>
+
+namespace udho{
+
+/**
+ * pool of worker threads that runs the blocking handlers away from the io threads.
+ * The threads are started with the first submitted task. A task is rejected once limit tasks are queued or running.
+ * @code
+ * udho::workers& pool = server._attachment.aux().workers();
+ * pool.queued(); pool.running(); pool.waited();
+ * @endcode
+ * \ingroup server
+ */
+class workers{
+    typedef std::chrono::steady_clock clock_type;
+    
+    std::once_flag                             _started;
+    std::unique_ptr<boost::asio::thread_pool>  _pool;
+    std::atomic<std::size_t>                   _pending;
+    std::atomic<std::size_t>                   _running;
+    std::atomic<std::size_t>                   _peak;
+    std::atomic<std::uint64_t>                 _completed;
+    std::atomic<std::uint64_t>                 _rejected;
+    std::atomic<std::uint64_t>                 _waited;
+    std::atomic<std::uint64_t>                 _longest;
+  public:
+    workers(): _pending(0), _running(0), _peak(0), _completed(0), _rejected(0), _waited(0), _longest(0){}
+    workers(const workers&) = delete;
+    workers& operator=(const workers&) = delete;
+    /**
+     * waits for the queued tasks to finish
+     */
+    ~workers(){
+        if(_pool){
+            _pool->join();
+        }
+    }
+    /**
+     * queues the task unless limit tasks are already queued or running
+     * @param threads number of worker threads, used by the first call only
+     * @return false if the task has been rejected
+     */
+    bool submit(std::function<void ()> task, std::size_t threads, std::size_t limit){
+        std::size_t pending = _pending.load(std::memory_order_relaxed);
+        do{
+            if(pending >= limit){
+                _rejected.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+        }while(!_pending.compare_exchange_weak(pending, pending+1, std::memory_order_relaxed));
+        std::size_t peak = _peak.load(std::memory_order_relaxed);
+        while(pending+1 > peak && !_peak.compare_exchange_weak(peak, pending+1, std::memory_order_relaxed));
+        
+        std::call_once(_started, [this, threads](){
+            _pool.reset(new boost::asio::thread_pool(threads ? threads : 1));
+        });
+        clock_type::time_point queued = clock_type::now();
+        boost::asio::post(*_pool, [this, task, queued](){
+            run(task, queued);
+        });
+        return true;
+    }
+    /**
+     * number of tasks waiting for a worker thread
+     */
+    std::size_t queued() const{
+        std::size_t pending = _pending.load(std::memory_order_relaxed), running = _running.load(std::memory_order_relaxed);
+        return pending > running ? pending - running : 0;
+    }
+    /**
+     * number of tasks being run by the worker threads
+     */
+    std::size_t running() const{
+        return _running.load(std::memory_order_relaxed);
+    }
+    /**
+     * highest number of tasks queued or running at once
+     */
+    std::size_t peak() const{
+        return _peak.load(std::memory_order_relaxed);
+    }
+    std::uint64_t completed() const{
+        return _completed.load(std::memory_order_relaxed);
+    }
+    std::uint64_t rejected() const{
+        return _rejected.load(std::memory_order_relaxed);
+    }
+    /**
+     * total time the completed tasks waited in the queue before being run
+     */
+    std::chrono::microseconds waited() const{
+        return std::chrono::microseconds(_waited.load(std::memory_order_relaxed));
+    }
+    /**
+     * longest time a task waited in the queue before being run
+     */
+    std::chrono::microseconds longest() const{
+        return std::chrono::microseconds(_longest.load(std::memory_order_relaxed));
+    }
+    /**
+     * current values of the gauges and counters by name, wait times in microseconds
+     */
+    std::map<std::string, std::uint64_t> snapshot() const{
+        std::map<std::string, std::uint64_t> values;
+        values["queued"]    = queued();
+        values["running"]   = running();
+        values["peak"]      = peak();
+        values["completed"] = completed();
+        values["rejected"]  = rejected();
+        values["waited"]    = waited().count();
+        values["longest"]   = longest().count();
+        return values;
+    }
+  private:
+    void run(const std::function<void ()>& task, clock_type::time_point queued){
+        std::uint64_t wait = std::chrono::duration_cast<std::chrono::microseconds>(clock_type::now() - queued).count();
+        _waited.fetch_add(wait, std::memory_order_relaxed);
+        std::uint64_t longest = _longest.load(std::memory_order_relaxed);
+        while(wait > longest && !_longest.compare_exchange_weak(longest, wait, std::memory_order_relaxed));
+        
+        _running.fetch_add(1, std::memory_order_relaxed);
+        try{
+            task();
+        }catch(...){}
+        _running.fetch_sub(1, std::memory_order_relaxed);
+        _completed.fetch_add(1, std::memory_order_relaxed);
+        _pending.fetch_sub(1, std::memory_order_relaxed);
+    }
+};
+
+}
+
+#endif // UDHO_WORKERS_H
@@ -7,6 +7,8 @@
 #include <boost/regex.hpp>
 #include <boost/algorithm/string_regex.hpp>
 #include <udho/router.h>
+#include <udho/radix.h>
+#include <udho/application.h>
 #include <boost/lexical_cast.hpp>
 #include <boost/bind.hpp>
 #include <udho/server.h>
@@ -48,6 +50,30 @@ int add(context_type ctx, int a, int b){
     return a + b;
 }
 
+std::string planet(context_type ctx, std::string name){
+    return "Hello "+name;
+}
+
+std::string created(context_type ctx, std::string name){
+    return "Created "+name;
+}
+
+std::string year(context_type ctx, int y){
+    return "Year "+boost::lexical_cast<std::string>(y);
+}
+
+double scale(context_type ctx, double factor, int value){
+    return factor * value;
+}
+
+std::size_t length(context_type ctx, boost::string_view name){
+    return name.size();
+}
+
+std::string asset(context_type ctx, std::string path){
+    return "Asset "+path;
+}
+
 boost::beast::http::response<boost::beast::http::file_body> file(context_type ctx){
     std::string path("/etc/passwd");
     boost::beast::error_code err;
@@ -71,6 +97,21 @@ boost::beast::http::response<boost::beast::http::string_body> page(context_type
     return res;
 }
 
+struct counter_app: public udho::application<counter_app>{
+    std::string _label;
+    int         _hits;
+    
+    counter_app(): udho::application<counter_app>("counter"), _label("counted"), _hits(0){}
+    std::string hit(context_type ctx, int step){
+        _hits += step;
+        return _label+" "+boost::lexical_cast<std::string>(_hits);
+    }
+    template <typename RouterT>
+    auto route(RouterT& router){
+        return router | (get(&counter_app::hit).plain() = "^/hit/(\\d+)$");
+    }
+};
+
 BOOST_AUTO_TEST_SUITE(router)
 
 BOOST_AUTO_TEST_CASE(mapping){
@@ -103,4 +144,169 @@ BOOST_AUTO_TEST_CASE(mapping){
     }));
 }
 
+BOOST_AUTO_TEST_CASE(captures){
+    auto router = udho::router()
+        | (udho::get(&planet).plain()   = "^/planet/(\\w+)$")
+        | (udho::post(&created).plain() = "^/planet/(\\w+)$");
+        
+    boost::asio::io_service io;
+    
+    context_type::request_type req;
+    server_type::attachment_type attachment(io);
+    context_type ctx(attachment.aux(), req, attachment);
+    int status = router.serve(ctx, boost::beast::http::verb::get, "/planet/M%61rs", generate_checker([](const std::string& res){
+        BOOST_CHECK(res == "Hello Mars");
+    }));
+    BOOST_CHECK(status == 200);
+    status = router.serve(ctx, boost::beast::http::verb::post, "/planet/Venus", generate_checker([](const std::string& res){
+        BOOST_CHECK(res == "Created Venus");
+    }));
+    BOOST_CHECK(status == 200);
+    status = router.serve(ctx, boost::beast::http::verb::put, "/planet/Venus", generate_checker([](const std::string& res){
+        BOOST_CHECK_MESSAGE(false, "no route expected for PUT");
+    }));
+    BOOST_CHECK(status == 0);
+}
+
+BOOST_AUTO_TEST_CASE(invalid_pattern){
+    BOOST_CHECK_THROW(udho::get(&hello).plain() = "^/hello/(\\d+$", std::exception);
+}
+
+BOOST_AUTO_TEST_CASE(arguments){
+    auto router = udho::router()
+        | (udho::get(&add).plain()             = "^/add/(-?\\d+)/(-?\\d+)$")
+        | (udho::get(&add).plain().strict()    = "^/strict/add/(-?\\d+)/(-?\\d+)$")
+        | (udho::get(&scale).plain().strict()  = "^/scale/([^/]+)/([^/]+)$")
+        | (udho::get(&length).plain()          = "^/length/([^/]+)$");
+        
+    boost::asio::io_service io;
+    
+    context_type::request_type req;
+    server_type::attachment_type attachment(io);
+    context_type ctx(attachment.aux(), req, attachment);
+    router.serve(ctx, boost::beast::http::verb::get, "/add/-2/5", generate_checker([](const std::string& res){
+        BOOST_CHECK(res == "3");
+    }));
+    // overflowing argument is default constructed unless the route is strict
+    router.serve(ctx, boost::beast::http::verb::get, "/add/99999999999/5", generate_checker([](const std::string& res){
+        BOOST_CHECK(res == "5");
+    }));
+    int status = router.serve(ctx, boost::beast::http::verb::get, "/strict/add/99999999999/5", generate_checker([](const std::string& res){}));
+    BOOST_CHECK(status == 400);
+    status = router.serve(ctx, boost::beast::http::verb::get, "/scale/2.5/4", generate_checker([](const std::string& res){
+        BOOST_CHECK(res == "10");
+    }));
+    BOOST_CHECK(status == 200);
+    status = router.serve(ctx, boost::beast::http::verb::get, "/scale/2.5x/4", generate_checker([](const std::string& res){}));
+    BOOST_CHECK(status == 400);
+    router.serve(ctx, boost::beast::http::verb::get, "/length/udho", generate_checker([](const std::string& res){
+        BOOST_CHECK(res == "4");
+    }));
+}
+
+BOOST_AUTO_TEST_CASE(application){
+    counter_app shared;
+    auto router = udho::router()
+        | (udho::app<counter_app>() = "^/owned")
+        | (udho::app(shared)        = "^/shared");
+        
+    boost::asio::io_service io;
+    
+    context_type::request_type req;
+    server_type::attachment_type attachment(io);
+    context_type ctx(attachment.aux(), req, attachment);
+    router.serve(ctx, boost::beast::http::verb::get, "/owned/hit/2", generate_checker([](const std::string& res){
+        BOOST_CHECK(res == "counted 2");
+    }));
+    router.serve(ctx, boost::beast::http::verb::get, "/owned/hit/3", generate_checker([](const std::string& res){
+        BOOST_CHECK(res == "counted 5");
+    }));
+    router.serve(ctx, boost::beast::http::verb::get, "/shared/hit/4", generate_checker([](const std::string& res){
+        BOOST_CHECK(res == "counted 4");
+    }));
+    BOOST_CHECK(shared._hits == 4);
+    std::vector<udho::module_info> summary;
+    router.summary(summary);
+    BOOST_CHECK(summary.size() == 2);
+}
+
+BOOST_AUTO_TEST_CASE(indexed){
+    auto router = udho::indexed(udho::router()
+        | (udho::get(&planet).plain()   = "^/planet/(\\w+)$")
+        | (udho::post(&created).plain() = "^/planet/(\\w+)$")
+        | (udho::get(&hello).plain()    = "^/planet/earth$"));
+        
+    boost::asio::io_service io;
+    
+    context_type::request_type req;
+    server_type::attachment_type attachment(io);
+    context_type ctx(attachment.aux(), req, attachment);
+    int status = router.serve(ctx, boost::beast::http::verb::get, "/planet/M%61rs", generate_checker([](const std::string& res){
+        BOOST_CHECK(res == "Hello Mars");
+    }));
+    BOOST_CHECK(status == 200);
+    router.serve(ctx, boost::beast::http::verb::get, "/planet/earth", generate_checker([](const std::string& res){
+        BOOST_CHECK(res == "Hello World");
+    }));
+    router.serve(ctx, boost::beast::http::verb::post, "/planet/earth", generate_checker([](const std::string& res){
+        BOOST_CHECK(res == "Created earth");
+    }));
+    status = router.serve(ctx, boost::beast::http::verb::put, "/planet/Venus", generate_checker([](const std::string& res){
+        BOOST_CHECK_MESSAGE(false, "no route expected for PUT");
+    }));
+    BOOST_CHECK(status == 0);
+}
+
+BOOST_AUTO_TEST_CASE(radix){
+    auto router = udho::radix(udho::router()
+        | (udho::get(&hello).plain()    = "^/hello$")
+        | (udho::get(&asset).plain()    = "^/assets/(.*)$")
+        | (udho::get(&add).plain()      = "^/add/{int}/{int}$")
+        | (udho::get(&planet).plain()   = "^/planet/{string}$")
+        | (udho::post(&created).plain() = "^/planet/([^/]+)$")
+        | (udho::get(&year).plain()     = "^/year/(\\d{4})$")
+        | (udho::get(&data).json()      = "^/assets/data$")
+        | (udho::get(&page).raw()       = "^/page"));
+        
+    boost::asio::io_service io;
+    
+    context_type::request_type req;
+    server_type::attachment_type attachment(io);
+    context_type ctx(attachment.aux(), req, attachment);
+    router.serve(ctx, boost::beast::http::verb::get, "/hello", generate_checker([](const std::string& res){
+        BOOST_CHECK(res == "Hello World");
+    }));
+    router.serve(ctx, boost::beast::http::verb::get, "/add/2/3", generate_checker([](const std::string& res){
+        BOOST_CHECK(res == "5");
+    }));
+    router.serve(ctx, boost::beast::http::verb::get, "/planet/M%61rs", generate_checker([](const std::string& res){
+        BOOST_CHECK(res == "Hello Mars");
+    }));
+    router.serve(ctx, boost::beast::http::verb::post, "/planet/Venus", generate_checker([](const std::string& res){
+        BOOST_CHECK(res == "Created Venus");
+    }));
+    router.serve(ctx, boost::beast::http::verb::get, "/assets/css/site.css", generate_checker([](const std::string& res){
+        BOOST_CHECK(res == "Asset css/site.css");
+    }));
+    // the url mapping attached last wins
+    router.serve(ctx, boost::beast::http::verb::get, "/assets/data", generate_checker([](const std::string& res){
+        BOOST_CHECK(res == "{id: 2, name: 'udho'}");
+    }));
+    // not expressible in the tree, matched with the regex
+    router.serve(ctx, boost::beast::http::verb::get, "/year/2020", generate_checker([](const std::string& res){
+        BOOST_CHECK(res == "Year 2020");
+    }));
+    router.serve(ctx, boost::beast::http::verb::get, "/pages/1", generate_checker([](const std::string& res){
+        BOOST_CHECK(res == "nothing");
+    }));
+    int status = router.serve(ctx, boost::beast::http::verb::get, "/add/2/x", generate_checker([](const std::string& res){
+        BOOST_CHECK_MESSAGE(false, "no route expected for /add/2/x");
+    }));
+    BOOST_CHECK(status == 0);
+    status = router.serve(ctx, boost::beast::http::verb::put, "/hello", generate_checker([](const std::string& res){
+        BOOST_CHECK_MESSAGE(false, "no route expected for PUT");
+    }));
+    BOOST_CHECK(status == 0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
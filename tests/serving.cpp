@@ -0,0 +1,1010 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE "udho Unit Test (udho::server)"
+#include <boost/test/unit_test.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/asio.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <udho/router.h>
+#include <udho/server.h>
+#include <udho/contexts.h>
+#include <udho/io_pool.h>
+#include <udho/compression.h>
+#include <udho/ranges.h>
+#include <udho/metrics.h>
+#include <udho/workers.h>
+#include <udho/sse.h>
+#include <udho/websocket.h>
+#include <boost/beast/websocket.hpp>
+#include <boost/format.hpp>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <future>
+#include <ctime>
+#include <cmath>
+
+typedef udho::servers::quiet::stateless server_type;
+typedef udho::contexts::stateless context_type;
+
+namespace http = boost::beast::http;
+
+/**
+ * serves a router on localhost in a background thread with a temporary document root
+ */
+struct running{
+    boost::filesystem::path _docroot;
+    udho::io_pool           _pool;
+    server_type             _server;
+    unsigned short          _port;
+
+    explicit running(unsigned short port): _docroot(boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()), _pool(1, false), _server(_pool.context(0)), _port(port){
+        boost::filesystem::create_directories(_docroot);
+        _server[udho::configs::server::document_root] = _docroot;
+    }
+    ~running(){
+        _pool.stop();
+        _pool.join();
+        boost::filesystem::remove_all(_docroot);
+    }
+    template <typename RouterT>
+    void serve(RouterT& router){
+        _server.serve(router, _pool, _port);
+        _pool.start();
+    }
+    std::string write(const std::string& name, std::size_t size){
+        std::string content(size, '\0');
+        for(std::size_t i = 0; i < size; ++i){
+            content[i] = static_cast<char>('a' + (i * 7) % 26);
+        }
+        std::ofstream file((_docroot / name).c_str(), std::ios::binary);
+        file << content;
+        return content;
+    }
+};
+
+/**
+ * sends the requests over a single keep-alive connection and returns the responses
+ */
+std::vector<http::response<http::string_body>> fetch(unsigned short port, std::vector<http::request<http::empty_body>> requests){
+    boost::asio::io_context io;
+    boost::asio::ip::tcp::socket socket(io);
+    socket.connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), port));
+    boost::beast::flat_buffer buffer;
+    std::vector<http::response<http::string_body>> responses;
+    for(auto& req: requests){
+        req.set(http::field::host, "localhost");
+        http::write(socket, req);
+        http::response_parser<http::string_body> parser;
+        parser.body_limit(64 * 1024 * 1024);
+        parser.skip(req.method() == http::verb::head);
+        http::read(socket, buffer, parser);
+        responses.push_back(parser.release());
+    }
+    boost::system::error_code ec;
+    socket.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ec);
+    return responses;
+}
+
+/**
+ * writes all requests at once before reading any response
+ */
+std::vector<http::response<http::string_body>> pipeline(unsigned short port, std::vector<http::request<http::empty_body>> requests){
+    boost::asio::io_context io;
+    boost::asio::ip::tcp::socket socket(io);
+    socket.connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), port));
+    std::string batch;
+    for(auto& req: requests){
+        req.set(http::field::host, "localhost");
+        std::stringstream stream;
+        stream << req;
+        batch += stream.str();
+    }
+    boost::asio::write(socket, boost::asio::buffer(batch));
+    boost::beast::flat_buffer buffer;
+    std::vector<http::response<http::string_body>> responses;
+    for(auto& req: requests){
+        http::response_parser<http::string_body> parser;
+        parser.skip(req.method() == http::verb::head);
+        boost::system::error_code ec;
+        http::read(socket, buffer, parser, ec);
+        if(ec){
+            break;
+        }
+        responses.push_back(parser.release());
+    }
+    return responses;
+}
+
+http::request<http::empty_body> get(const std::string& target, http::verb method = http::verb::get){
+    http::request<http::empty_body> req{method, target, 11};
+    req.keep_alive(true);
+    return req;
+}
+
+http::response<http::file_body> asset(context_type ctx, std::string name){
+    return ctx.aux().file(name, ctx.request());
+}
+
+http::response<udho::ranged_file_body> ranged_asset(context_type ctx, std::string name){
+    return ctx.aux().ranged(name, ctx.request());
+}
+
+/**
+ * responds after the given delay from a timer, so that later pipelined requests finish first
+ */
+void delayed(context_type ctx, int delay){
+    auto timer = std::make_shared<boost::asio::steady_timer>(ctx.aux()._io, std::chrono::milliseconds(delay));
+    timer->async_wait([ctx, timer, delay](const boost::system::error_code&) mutable {
+        ctx.respond("delayed " + std::to_string(delay), "text/plain");
+    });
+}
+
+/**
+ * responds twice from a thread other than the ones running the io_context, only the first response must be sent
+ */
+void threaded(context_type ctx, int delay){
+    std::thread([ctx, delay]() mutable {
+        std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+        ctx.respond("threaded " + std::to_string(delay), "text/plain");
+        ctx.respond(std::string("again"), "text/plain");
+    }).detach();
+}
+
+/**
+ * sleeps on the thread it is called from, a bad request for a negative delay
+ */
+std::string slow(context_type /*ctx*/, int delay){
+    if(delay < 0){
+        throw udho::exceptions::http_error(http::status::bad_request, "negative delay");
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+    return "slept " + std::to_string(delay);
+}
+
+/**
+ * streams count csv rows, writing the next row once the previous one has been written
+ */
+void exported(context_type ctx, int count){
+    udho::stream out = ctx.stream("text/csv");
+    auto row = std::make_shared<udho::stream::handler_type>();
+    auto index = std::make_shared<int>(0);
+    *row = [out, row, index, count](const boost::system::error_code& ec) mutable {
+        if(ec){
+            return;
+        }
+        if(*index == count){
+            out.finish();
+            *row = nullptr;
+            return;
+        }
+        out.write(std::to_string(*index) + ",row " + std::to_string(*index) + "\n", *row);
+        ++*index;
+    };
+    (*row)(boost::system::error_code());
+}
+
+/**
+ * streams from a thread without waiting for the chunks to be written, dropping the stream unfinished for a negative count
+ */
+void produced(context_type ctx, int count){
+    udho::stream out = ctx.stream("text/plain");
+    std::thread([out, count]() mutable {
+        for(int i = 0; i < std::abs(count); ++i){
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            out.write(std::to_string(i) + ";");
+        }
+        if(count >= 0){
+            out.finish();
+        }
+    }).detach();
+}
+
+std::string csv_rows(int count){
+    std::string csv;
+    for(int i = 0; i < count; ++i){
+        csv += std::to_string(i) + ",row " + std::to_string(i) + "\n";
+    }
+    return csv;
+}
+
+/**
+ * subscribes to the events of the board named in the path
+ */
+std::string board(context_type /*ctx*/, std::string name){
+    return name;
+}
+
+/**
+ * an open connection to the server that reads what is received until some expected text arrives, or gives up after two seconds
+ */
+struct listening{
+    boost::asio::io_context      _io;
+    boost::asio::ip::tcp::socket _socket;
+    std::string                  _received;
+    
+    listening(unsigned short port, const std::string& target): _socket(_io){
+        _socket.connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), port));
+        struct timeval timeout = {2, 0};
+        setsockopt(_socket.native_handle(), SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        auto req = get(target);
+        req.set(http::field::host, "localhost");
+        http::write(_socket, req);
+    }
+    bool until(const std::string& expected){
+        char buffer[4096];
+        while(_received.find(expected) == std::string::npos){
+            boost::system::error_code ec;
+            std::size_t bytes = _socket.read_some(boost::asio::buffer(buffer), ec);
+            if(ec){
+                return false;
+            }
+            _received.append(buffer, bytes);
+        }
+        return true;
+    }
+};
+
+/**
+ * echoes the messages prefixed with the cookie of the upgrade request. A burst of messages is sent beyond the bound of the outgoing queue and bye closes the connection.
+ */
+udho::websocket::handlers echo(context_type ctx){
+    std::string name = ctx.cookies().exists("name") ? ctx.cookies().get<std::string>("name") : "anonymous";
+    ctx.cookies() << udho::cookie("greeted", std::string("yes"));
+    auto accepted = std::make_shared<int>(0);
+    return udho::websocket::handlers()
+        .on_open([name](udho::websocket::peer peer){
+            peer.send("hello " + name);
+        })
+        .on_message([name, accepted](udho::websocket::peer peer, const std::string& message, bool binary){
+            if(message == "bye"){
+                return peer.close();
+            }
+            if(message == "burst"){
+                for(int i = 0; i < 10; ++i){
+                    *accepted += peer.send(std::to_string(i)) ? 1 : 0;
+                }
+                return;
+            }
+            if(message == "accepted"){
+                peer.send("accepted " + std::to_string(*accepted));
+                return;
+            }
+            peer.send(std::make_shared<const std::string>(name + ": " + message), binary);
+        });
+}
+
+std::string json_records(int count){
+    std::string json = "[";
+    for(int i = 0; i < count; ++i){
+        json += (i ? "," : "") + (boost::format("{\"id\": %1%, \"name\": \"record %1%\"}") % i).str();
+    }
+    return json + "]";
+}
+
+std::string records(context_type /*ctx*/, int count){
+    return json_records(count);
+}
+
+#ifdef WITH_ZLIB
+std::string inflate(const std::string& input, bool gzip){
+    z_stream stream = {};
+    inflateInit2(&stream, gzip ? 15 + 16 : 15);
+    std::string output;
+    char buffer[4096];
+    stream.next_in  = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+    stream.avail_in = static_cast<uInt>(input.size());
+    int result = Z_OK;
+    while(result == Z_OK){
+        stream.next_out  = reinterpret_cast<Bytef*>(buffer);
+        stream.avail_out = sizeof(buffer);
+        result = ::inflate(&stream, Z_NO_FLUSH);
+        output.append(buffer, sizeof(buffer) - stream.avail_out);
+    }
+    inflateEnd(&stream);
+    return result == Z_STREAM_END ? output : std::string();
+}
+#endif
+
+BOOST_AUTO_TEST_SUITE(server)
+
+BOOST_AUTO_TEST_CASE(static_files){
+    running server(19301);
+    std::string big   = server.write("big.bin", 3 * 1024 * 1024 + 17);
+    std::string small = server.write("small.txt", 5);
+    auto router = udho::router() | (udho::get(&asset).raw() = "^/asset/(.+)$");
+    server.serve(router);
+
+    auto responses = fetch(19301, {get("/big.bin"), get("/small.txt"), get("/asset/big.bin"), get("/big.bin", http::verb::head), get("/missing.txt")});
+    BOOST_REQUIRE(responses.size() == 5);
+    BOOST_CHECK(responses[0].result() == http::status::ok);
+    BOOST_CHECK(responses[0].body() == big);
+    BOOST_CHECK(responses[0][http::field::content_type] == "application/octet-stream");
+    BOOST_CHECK(responses[1].body() == small);
+    BOOST_CHECK(responses[1][http::field::content_type] == "text/plain");
+    BOOST_CHECK(responses[2].body() == big);
+    BOOST_CHECK(responses[3].result() == http::status::ok);
+    BOOST_CHECK(responses[3][http::field::content_length] == std::to_string(big.size()));
+    BOOST_CHECK(responses[4].result() == http::status::not_found);
+}
+
+BOOST_AUTO_TEST_CASE(asset_cache){
+    running server(19302);
+    server._server[udho::configs::assets::cache] = true;
+    server._server[udho::configs::assets::revalidate] = std::chrono::milliseconds(0);
+    server._server[udho::configs::assets::file_limit] = 1024;
+    std::string small = server.write("small.txt", 100);
+    std::string large = server.write("large.txt", 4096);
+    auto router = udho::router() | (udho::get(&asset).raw() = "^/asset/(.+)$");
+    server.serve(router);
+
+    auto responses = fetch(19302, {get("/small.txt"), get("/large.txt")});
+    BOOST_CHECK(responses[0].body() == small);
+    BOOST_CHECK(responses[1].body() == large);
+    std::string etag = responses[0][http::field::etag].to_string();
+    std::string last_modified = responses[0][http::field::last_modified].to_string();
+    BOOST_CHECK(!etag.empty());
+    BOOST_CHECK(!last_modified.empty());
+    BOOST_CHECK(server._server._attachment.aux().assets().count() == 1);
+    
+    auto conditional = get("/small.txt");
+    conditional.set(http::field::if_none_match, "\"other\", "+etag);
+    auto modified_since = get("/small.txt");
+    modified_since.set(http::field::if_modified_since, last_modified);
+    auto mismatched = get("/small.txt");
+    mismatched.set(http::field::if_none_match, "\"other\"");
+    responses = fetch(19302, {conditional, modified_since, mismatched});
+    BOOST_CHECK(responses[0].result() == http::status::not_modified);
+    BOOST_CHECK(responses[0].body().empty());
+    BOOST_CHECK(responses[1].result() == http::status::not_modified);
+    BOOST_CHECK(responses[2].result() == http::status::ok);
+    BOOST_CHECK(responses[2].body() == small);
+    
+    // changing the file invalidates the cached copy
+    std::string changed = server.write("small.txt", 50);
+    boost::filesystem::last_write_time(server._docroot / "small.txt", std::time(nullptr) + 10);
+    responses = fetch(19302, {conditional});
+    BOOST_CHECK(responses[0].result() == http::status::ok);
+    BOOST_CHECK(responses[0].body() == changed);
+    BOOST_CHECK(responses[0][http::field::etag] != etag);
+}
+
+#ifdef WITH_ZLIB
+BOOST_AUTO_TEST_CASE(precompressed){
+    running server(19303);
+    server._server[udho::configs::assets::precompressed] = true;
+    std::string script = server.write("app.js", 4096);
+    BOOST_CHECK(udho::compression::precompress(server._docroot) >= 1);
+    BOOST_REQUIRE(boost::filesystem::exists(server._docroot / "app.js.gz"));
+    std::ifstream gz((server._docroot / "app.js.gz").c_str(), std::ios::binary);
+    std::string compressed((std::istreambuf_iterator<char>(gz)), std::istreambuf_iterator<char>());
+    auto router = udho::router() | (udho::get(&asset).raw() = "^/asset/(.+)$");
+    server.serve(router);
+    
+    auto gzipped = get("/app.js");
+    gzipped.set(http::field::accept_encoding, "gzip, deflate");
+    auto refused = get("/app.js");
+    refused.set(http::field::accept_encoding, "gzip;q=0, identity");
+    auto through_bridge = get("/asset/app.js");
+    through_bridge.set(http::field::accept_encoding, "gzip");
+    auto responses = fetch(19303, {gzipped, refused, get("/app.js"), through_bridge});
+    BOOST_CHECK(responses[0][http::field::content_encoding] == "gzip");
+    BOOST_CHECK(responses[0][http::field::content_type] == "application/javascript");
+    BOOST_CHECK(responses[0][http::field::vary] == "Accept-Encoding");
+    BOOST_CHECK(responses[0].body() == compressed);
+    BOOST_CHECK(responses[1][http::field::content_encoding].empty());
+    BOOST_CHECK(responses[1][http::field::vary] == "Accept-Encoding");
+    BOOST_CHECK(responses[1].body() == script);
+    BOOST_CHECK(responses[2].body() == script);
+    BOOST_CHECK(responses[3][http::field::content_encoding] == "gzip");
+    BOOST_CHECK(responses[3].body() == compressed);
+}
+#endif
+
+BOOST_AUTO_TEST_CASE(compressed_responses){
+    running server(19304);
+    auto router = udho::router()
+        | (udho::get(&records).json().compressed() = "^/records/(\\d+)$")
+        | (udho::get(&records).json().compressed(9, 1024, 64 * 1024) = "^/stream/(\\d+)$");
+    server.serve(router);
+    
+    std::string expected = json_records(10000);
+    auto gzipped = get("/records/10000");
+    gzipped.set(http::field::accept_encoding, "gzip, deflate");
+    auto deflated = get("/records/10000");
+    deflated.set(http::field::accept_encoding, "deflate, gzip;q=0.5");
+    auto small = get("/records/1");
+    small.set(http::field::accept_encoding, "gzip");
+    auto streamed = get("/stream/10000");
+    streamed.set(http::field::accept_encoding, "gzip");
+    auto responses = fetch(19304, {gzipped, deflated, get("/records/10000"), small, streamed});
+    BOOST_REQUIRE(responses.size() == 5);
+    BOOST_CHECK(responses[0][http::field::content_type] == "application/json");
+    BOOST_CHECK(responses[0][http::field::vary] == "Accept-Encoding");
+    BOOST_CHECK(responses[2][http::field::content_encoding].empty());
+    BOOST_CHECK(responses[2].body() == expected);
+    BOOST_CHECK(responses[3][http::field::content_encoding].empty());
+    BOOST_CHECK(responses[3].body() == json_records(1));
+#ifdef WITH_ZLIB
+    BOOST_CHECK(responses[0][http::field::content_encoding] == "gzip");
+    BOOST_CHECK(responses[0].body().size() < expected.size() / 4);
+    BOOST_CHECK(inflate(responses[0].body(), true) == expected);
+    BOOST_CHECK(responses[1][http::field::content_encoding] == "deflate");
+    BOOST_CHECK(inflate(responses[1].body(), false) == expected);
+    BOOST_CHECK(responses[4][http::field::content_encoding] == "gzip");
+    BOOST_CHECK(responses[4].chunked());
+    BOOST_CHECK(inflate(responses[4].body(), true) == expected);
+#endif
+}
+
+BOOST_AUTO_TEST_CASE(byte_ranges){
+    std::vector<udho::byte_range> ranges;
+    BOOST_CHECK(udho::internal::parse_ranges("bytes=0-99", 1000, ranges) == udho::internal::range_status::partial);
+    BOOST_CHECK(ranges.size() == 1 && ranges[0]._first == 0 && ranges[0]._last == 99);
+    BOOST_CHECK(udho::internal::parse_ranges("bytes=-100", 1000, ranges) == udho::internal::range_status::partial);
+    BOOST_CHECK(ranges[0]._first == 900 && ranges[0]._last == 999);
+    BOOST_CHECK(udho::internal::parse_ranges("bytes=900-", 1000, ranges) == udho::internal::range_status::partial);
+    BOOST_CHECK(ranges[0]._first == 900 && ranges[0]._last == 999);
+    BOOST_CHECK(udho::internal::parse_ranges("bytes=500-2000", 1000, ranges) == udho::internal::range_status::partial);
+    BOOST_CHECK(ranges[0]._last == 999);
+    BOOST_CHECK(udho::internal::parse_ranges("bytes=0-10, 5-20, 21-30, 100-200", 1000, ranges) == udho::internal::range_status::partial);
+    BOOST_CHECK(ranges.size() == 2 && ranges[0]._last == 30 && ranges[1]._first == 100);
+    BOOST_CHECK(udho::internal::parse_ranges("bytes=1000-", 1000, ranges) == udho::internal::range_status::unsatisfiable);
+    BOOST_CHECK(udho::internal::parse_ranges("bytes=-0", 1000, ranges) == udho::internal::range_status::unsatisfiable);
+    BOOST_CHECK(udho::internal::parse_ranges("bytes=20-10", 1000, ranges) == udho::internal::range_status::full);
+    BOOST_CHECK(udho::internal::parse_ranges("items=0-10", 1000, ranges) == udho::internal::range_status::full);
+    BOOST_CHECK(udho::internal::parse_ranges("bytes=a-b", 1000, ranges) == udho::internal::range_status::full);
+}
+
+BOOST_AUTO_TEST_CASE(partial_content){
+    running server(19305);
+    std::string video = server.write("video.bin", 2 * 1024 * 1024 + 5);
+    std::string small = server.write("small.txt", 100);
+    server._server[udho::configs::assets::cache] = true;
+    server._server[udho::configs::assets::file_limit] = 1024;
+    auto router = udho::router() | (udho::get(&ranged_asset).raw() = "^/ranged/(.+)$");
+    server.serve(router);
+    
+    auto whole = fetch(19305, {get("/video.bin")});
+    BOOST_CHECK(whole[0].result() == http::status::ok);
+    BOOST_CHECK(whole[0][http::field::accept_ranges] == "bytes");
+    BOOST_CHECK(whole[0].body() == video);
+    std::string etag = whole[0][http::field::etag].to_string();
+    BOOST_CHECK(!etag.empty());
+    
+    auto single = get("/video.bin");
+    single.set(http::field::range, "bytes=1048570-1048589");
+    auto suffix = get("/video.bin");
+    suffix.set(http::field::range, "bytes=-10");
+    auto multiple = get("/video.bin");
+    multiple.set(http::field::range, "bytes=0-4, 2000000-2000009");
+    auto unsatisfiable = get("/video.bin");
+    unsatisfiable.set(http::field::range, "bytes=9999999-");
+    auto matching = get("/video.bin");
+    matching.set(http::field::range, "bytes=0-9");
+    matching.set(http::field::if_range, etag);
+    auto stale = get("/video.bin");
+    stale.set(http::field::range, "bytes=0-9");
+    stale.set(http::field::if_range, "\"stale\"");
+    auto head = get("/video.bin", http::verb::head);
+    head.set(http::field::range, "bytes=0-9");
+    auto cached = get("/small.txt");
+    cached.set(http::field::range, "bytes=10-19");
+    auto bridged = get("/ranged/video.bin");
+    bridged.set(http::field::range, "bytes=100-199");
+    auto responses = fetch(19305, {single, suffix, multiple, unsatisfiable, matching, stale, head, cached, bridged});
+    BOOST_REQUIRE(responses.size() == 9);
+    BOOST_CHECK(responses[0].result() == http::status::partial_content);
+    BOOST_CHECK(responses[0][http::field::content_range] == "bytes 1048570-1048589/" + std::to_string(video.size()));
+    BOOST_CHECK(responses[0].body() == video.substr(1048570, 20));
+    BOOST_CHECK(responses[1].body() == video.substr(video.size() - 10));
+    BOOST_CHECK(responses[2].result() == http::status::partial_content);
+    std::string multipart = responses[2][http::field::content_type].to_string();
+    BOOST_CHECK(multipart.compare(0, 31, "multipart/byteranges; boundary=") == 0);
+    std::string boundary = multipart.substr(31);
+    std::string expected = "--" + boundary + "\r\nContent-Type: application/octet-stream\r\nContent-Range: bytes 0-4/" + std::to_string(video.size()) + "\r\n\r\n" + video.substr(0, 5)
+                         + "\r\n--" + boundary + "\r\nContent-Type: application/octet-stream\r\nContent-Range: bytes 2000000-2000009/" + std::to_string(video.size()) + "\r\n\r\n" + video.substr(2000000, 10)
+                         + "\r\n--" + boundary + "--\r\n";
+    BOOST_CHECK(responses[2].body() == expected);
+    BOOST_CHECK(responses[3].result() == http::status::range_not_satisfiable);
+    BOOST_CHECK(responses[3][http::field::content_range] == "bytes */" + std::to_string(video.size()));
+    BOOST_CHECK(responses[4].result() == http::status::partial_content);
+    BOOST_CHECK(responses[4].body() == video.substr(0, 10));
+    BOOST_CHECK(responses[5].result() == http::status::ok);
+    BOOST_CHECK(responses[5].body() == video);
+    BOOST_CHECK(responses[6].result() == http::status::partial_content);
+    BOOST_CHECK(responses[6][http::field::content_length] == "10");
+    BOOST_CHECK(responses[7].result() == http::status::partial_content);
+    BOOST_CHECK(responses[7].body() == small.substr(10, 10));
+    BOOST_CHECK(responses[8].result() == http::status::partial_content);
+    BOOST_CHECK(responses[8].body() == video.substr(100, 100));
+}
+
+BOOST_AUTO_TEST_CASE(path_lookups){
+    BOOST_CHECK(udho::internal::path_inside("/srv/www", "/srv/www/index.html"));
+    BOOST_CHECK(udho::internal::path_inside("/srv/www", "/srv/www//css/./site.css"));
+    BOOST_CHECK(udho::internal::path_inside("/srv/www", "/srv/www/css/../index.html"));
+    BOOST_CHECK(!udho::internal::path_inside("/srv/www", "/srv/www/../secret"));
+    BOOST_CHECK(!udho::internal::path_inside("/srv/www", "/srv/www2/index.html"));
+    BOOST_CHECK(!udho::internal::path_inside("/srv/www", "/srv/www/css/../../www2/index.html"));
+    BOOST_CHECK(!udho::internal::path_inside("/srv/www", "/srv"));
+    
+    running server(19306);
+    server._server[udho::configs::assets::revalidate] = std::chrono::milliseconds(60 * 1000);
+    server.write("present.txt", 10);
+    auto router = udho::router() | (udho::get(&asset).raw() = "^/asset/(.+)$");
+    server.serve(router);
+    
+    auto responses = fetch(19306, {get("/present.txt"), get("/missing.txt"), get("/../etc/passwd"), get("/asset/missing.txt")});
+    BOOST_CHECK(responses[0].result() == http::status::ok);
+    BOOST_CHECK(responses[1].result() == http::status::not_found);
+    BOOST_CHECK(responses[2].result() == http::status::forbidden);
+    BOOST_CHECK(responses[3].result() == http::status::not_found);
+    udho::path_cache& paths = server._server._attachment.aux().paths();
+    BOOST_CHECK(paths.count() == 2);
+    
+    // the missing file is remembered until it is revalidated
+    server.write("missing.txt", 10);
+    responses = fetch(19306, {get("/missing.txt")});
+    BOOST_CHECK(responses[0].result() == http::status::not_found);
+    paths.forget(paths.root(server._docroot) / "missing.txt");
+    responses = fetch(19306, {get("/missing.txt")});
+    BOOST_CHECK(responses[0].result() == http::status::ok);
+    
+    // a deleted file is not served from a stale lookup
+    boost::filesystem::remove(server._docroot / "present.txt");
+    responses = fetch(19306, {get("/present.txt")});
+    BOOST_CHECK(responses[0].result() == http::status::not_found);
+}
+
+/**
+ * sends the raw bytes on a fresh connection and waits until the server closes it
+ */
+std::string closed_after(unsigned short port, const std::string& bytes){
+    boost::asio::io_context io;
+    boost::asio::ip::tcp::socket socket(io);
+    socket.connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), port));
+    if(!bytes.empty()){
+        boost::asio::write(socket, boost::asio::buffer(bytes));
+    }
+    std::string received;
+    boost::system::error_code ec;
+    boost::asio::read(socket, boost::asio::dynamic_buffer(received), ec);
+    return received;
+}
+
+BOOST_AUTO_TEST_CASE(timeouts){
+    running server(19307);
+    server._server[udho::configs::timeouts::idle]   = std::chrono::milliseconds(100);
+    server._server[udho::configs::timeouts::header] = std::chrono::milliseconds(100);
+    server._server[udho::configs::timeouts::body]   = std::chrono::milliseconds(100);
+    std::string small = server.write("small.txt", 5);
+    auto router = udho::router() | (udho::get(&asset).raw() = "^/asset/(.+)$");
+    server.serve(router);
+    udho::metrics& metrics = server._server._attachment.aux().metrics();
+    
+    auto responses = fetch(19307, {get("/small.txt"), get("/small.txt")});
+    BOOST_CHECK(responses[1].body() == small);
+    BOOST_CHECK(metrics[udho::metrics::idle_timeouts] == 0);
+    
+    BOOST_CHECK(closed_after(19307, "").empty());
+    BOOST_CHECK(metrics[udho::metrics::idle_timeouts] == 1);
+    BOOST_CHECK(closed_after(19307, "GET /small.txt HTTP/1.1\r\nHost: loc").empty());
+    BOOST_CHECK(metrics[udho::metrics::header_timeouts] == 1);
+    BOOST_CHECK(closed_after(19307, "POST /small.txt HTTP/1.1\r\nHost: localhost\r\nContent-Length: 100\r\n\r\nabc").empty());
+    BOOST_CHECK(metrics[udho::metrics::body_timeouts] == 1);
+    // an idle keep-alive connection is closed after its response
+    std::string received = closed_after(19307, "GET /small.txt HTTP/1.1\r\nHost: localhost\r\n\r\n");
+    BOOST_CHECK(received.find("200 OK") != std::string::npos);
+    BOOST_CHECK(metrics[udho::metrics::idle_timeouts] == 2);
+    BOOST_CHECK(metrics[udho::metrics::write_timeouts] == 0);
+}
+
+BOOST_AUTO_TEST_CASE(pipelining){
+    running server(19308);
+    server._server[udho::configs::server::pipeline] = 4;
+    std::string small = server.write("small.txt", 5);
+    auto router = udho::router()
+        | (udho::get(&delayed).deferred() = "^/delayed/(\\d+)$")
+        | (udho::get(&records).json() = "^/records/(\\d+)$");
+    server.serve(router);
+    
+    std::vector<http::request<http::empty_body>> requests = {get("/delayed/200"), get("/delayed/10"), get("/small.txt"), get("/records/2"), get("/delayed/50"), get("/missing.txt"), get("/small.txt", http::verb::head), get("/records/1")};
+    auto responses = pipeline(19308, requests);
+    BOOST_REQUIRE(responses.size() == requests.size());
+    BOOST_CHECK(responses[0].body() == "delayed 200");
+    BOOST_CHECK(responses[1].body() == "delayed 10");
+    BOOST_CHECK(responses[2].body() == small);
+    BOOST_CHECK(responses[3].body() == json_records(2));
+    BOOST_CHECK(responses[4].body() == "delayed 50");
+    BOOST_CHECK(responses[5].result() == http::status::not_found);
+    BOOST_CHECK(responses[6][http::field::content_length] == "5");
+    BOOST_CHECK(responses[7].body() == json_records(1));
+    
+    // the connection is closed after the response of a request that asks for it
+    auto last = get("/small.txt");
+    last.keep_alive(false);
+    responses = pipeline(19308, {get("/delayed/20"), last, get("/small.txt")});
+    BOOST_CHECK(responses.size() == 2);
+    BOOST_CHECK(responses[0].body() == "delayed 20");
+    BOOST_CHECK(responses[1].body() == small);
+}
+
+BOOST_AUTO_TEST_CASE(deferred_threads){
+    running server(19309);
+    std::string small = server.write("small.txt", 5);
+    auto router = udho::router()
+        | (udho::get(&threaded).deferred() = "^/threaded/(\\d+)$")
+        | (udho::get(&delayed).deferred()  = "^/delayed/(\\d+)$");
+    server.serve(router);
+    udho::metrics& metrics = server._server._attachment.aux().metrics();
+    
+    auto responses = pipeline(19309, {get("/threaded/100"), get("/threaded/0"), get("/small.txt"), get("/delayed/10"), get("/threaded/20")});
+    BOOST_REQUIRE(responses.size() == 5);
+    BOOST_CHECK(responses[0].body() == "threaded 100");
+    BOOST_CHECK(responses[1].body() == "threaded 0");
+    BOOST_CHECK(responses[2].body() == small);
+    BOOST_CHECK(responses[3].body() == "delayed 10");
+    BOOST_CHECK(responses[4].body() == "threaded 20");
+    
+    // the second response of each threaded request is rejected, even after the connection closed
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    BOOST_CHECK(metrics[udho::metrics::rejected_responses] == 3);
+}
+
+BOOST_AUTO_TEST_CASE(blocking_handlers){
+    running server(19310);
+    server._server[udho::configs::workers::threads] = 1;
+    server._server[udho::configs::workers::limit]   = 2;
+    std::string small = server.write("small.txt", 5);
+    auto router = udho::router()
+        | (udho::get(&slow).plain().blocking() = "^/slow/(-?\\d+)$")
+        | (udho::get(&records).json() = "^/records/(\\d+)$");
+    server.serve(router);
+    udho::workers& workers = server._server._attachment.aux().workers();
+    
+    auto request = [](const std::string& target){
+        return std::async(std::launch::async, [target](){
+            return fetch(19310, {get(target)}).front();
+        });
+    };
+    auto first = request("/slow/300");
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    auto second = request("/slow/10");
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    
+    // the io thread keeps serving while the only worker sleeps, and the third blocking request exceeds the limit
+    auto start = std::chrono::steady_clock::now();
+    auto responses = fetch(19310, {get("/records/2"), get("/small.txt"), get("/slow/10")});
+    BOOST_CHECK(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(150));
+    BOOST_CHECK(responses[0].body() == json_records(2));
+    BOOST_CHECK(responses[1].body() == small);
+    BOOST_CHECK(responses[2].result() == http::status::service_unavailable);
+    
+    auto slept = first.get();
+    BOOST_CHECK(slept.body() == "slept 300");
+    BOOST_CHECK(slept[http::field::content_type] == "text/plain");
+    BOOST_CHECK(second.get().body() == "slept 10");
+    BOOST_CHECK(workers.rejected() == 1);
+    BOOST_CHECK(workers.longest() >= std::chrono::milliseconds(150));
+    
+    responses = fetch(19310, {get("/slow/-1"), get("/slow/0")});
+    BOOST_CHECK(responses[0].result() == http::status::bad_request);
+    BOOST_CHECK(responses[1].body() == "slept 0");
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    BOOST_CHECK(workers.completed() == 4);
+    BOOST_CHECK(workers.queued() == 0);
+}
+
+BOOST_AUTO_TEST_CASE(streaming){
+    running server(19311);
+    std::string small = server.write("small.txt", 5);
+    auto router = udho::router()
+        | (udho::get(&exported).deferred() = "^/export/(\\d+)$")
+        | (udho::head(&exported).deferred() = "^/export/(\\d+)$")
+        | (udho::get(&produced).deferred() = "^/produce/(-?\\d+)$");
+    server.serve(router);
+    
+    auto responses = pipeline(19311, {get("/export/1000"), get("/small.txt"), get("/produce/3"), get("/export/0"), get("/export/2", http::verb::head)});
+    BOOST_REQUIRE(responses.size() == 5);
+    BOOST_CHECK(responses[0].chunked());
+    BOOST_CHECK(responses[0][http::field::content_type] == "text/csv");
+    BOOST_CHECK(responses[0].body() == csv_rows(1000));
+    BOOST_CHECK(responses[1].body() == small);
+    BOOST_CHECK(responses[2].body() == "0;1;2;");
+    BOOST_CHECK(responses[3].chunked());
+    BOOST_CHECK(responses[3].body().empty());
+    BOOST_CHECK(responses[4].body().empty());
+    
+    // HTTP/1.0 clients receive the body until the connection closes
+    auto old = get("/export/3");
+    old.version(10);
+    old.keep_alive(false);
+    old.set(http::field::host, "localhost");
+    std::string received = closed_after(19311, (boost::format("%1%") % old).str());
+    BOOST_CHECK(received.find("Transfer-Encoding") == std::string::npos);
+    BOOST_CHECK(received.size() > csv_rows(3).size() && received.substr(received.size() - csv_rows(3).size()) == csv_rows(3));
+    
+    // a stream dropped unfinished aborts the connection instead of completing the body
+    responses = pipeline(19311, {get("/produce/-3"), get("/small.txt")});
+    BOOST_CHECK(responses.empty());
+}
+
+BOOST_AUTO_TEST_CASE(server_sent_events){
+    running server(19312);
+    udho::sse::hub<std::string> boards(2);
+    auto router = udho::router() | (udho::get(&board).sse(boards) = "^/events/(\\w+)$");
+    server.serve(router);
+    
+    listening first(19312, "/events/sales"), second(19312, "/events/sales"), third(19312, "/events/stock");
+    for(int i = 0; i < 100 && boards.size() < 3; ++i){
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    BOOST_REQUIRE(boards.count("sales") == 2);
+    BOOST_CHECK(first.until("\r\n\r\n"));
+    BOOST_CHECK(first._received.find("Content-Type: text/event-stream") != std::string::npos);
+    BOOST_CHECK(first._received.find("Cache-Control: no-cache") != std::string::npos);
+    
+    udho::sse::event update("total 42\nitems 7", "update", "1");
+    BOOST_CHECK(update.str() == "id: 1\nevent: update\ndata: total 42\ndata: items 7\n\n");
+    BOOST_CHECK(boards.notify("sales", update) == 2);
+    BOOST_CHECK(first.until(update.str()));
+    BOOST_CHECK(second.until(update.str()));
+    BOOST_CHECK(boards.notify("stock", udho::sse::event("low")) == 1);
+    BOOST_CHECK(third.until("data: low\n\n"));
+    BOOST_CHECK(second._received.find("data: low") == std::string::npos);
+    
+    // closing a key ends the responses of its subscribers
+    BOOST_CHECK(boards.close("stock") == 1);
+    BOOST_CHECK(third.until("\r\n0\r\n\r\n"));
+    BOOST_CHECK(boards.count("stock") == 0);
+    
+    // subscribers whose connections failed are removed as events are sent to them
+    first._socket.close();
+    for(int i = 0; i < 100 && boards.count("sales") > 1; ++i){
+        boards.heartbeat();
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    BOOST_CHECK(boards.count("sales") == 1);
+    BOOST_CHECK(second.until(": \n\n"));
+}
+
+BOOST_AUTO_TEST_CASE(websockets){
+    namespace websocket = boost::beast::websocket;
+    running server(19313);
+    std::string small = server.write("small.txt", 5);
+    auto router = udho::router() 
+        | (udho::get(&echo).websocket(udho::websocket::options().queue(4).deflate()) = "^/echo$");
+    server.serve(router);
+    
+    // a plain request to a websocket route
+    auto responses = fetch(19313, {get("/echo"), get("/small.txt")});
+    BOOST_CHECK(responses[0].result() == http::status::upgrade_required);
+    BOOST_CHECK(responses[1].body() == small);
+    
+    boost::asio::io_context io;
+    websocket::stream<boost::asio::ip::tcp::socket> ws(io);
+    ws.next_layer().connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), 19313));
+    websocket::permessage_deflate deflate;
+    deflate.client_enable = true;
+    ws.set_option(deflate);
+    ws.set_option(websocket::stream_base::decorator([](websocket::request_type& req){
+        req.set(http::field::cookie, "name=neel");
+    }));
+    websocket::response_type upgraded;
+    ws.handshake(upgraded, "localhost", "/echo");
+    BOOST_CHECK(upgraded.result() == http::status::switching_protocols);
+    BOOST_CHECK(upgraded[http::field::set_cookie].to_string().find("greeted=yes") != std::string::npos);
+    BOOST_CHECK(upgraded[http::field::sec_websocket_extensions].to_string().find("permessage-deflate") != std::string::npos);
+    
+    auto receive = [&ws](){
+        boost::beast::flat_buffer buffer;
+        ws.read(buffer);
+        return boost::beast::buffers_to_string(buffer.data());
+    };
+    BOOST_CHECK(receive() == "hello neel");
+    ws.write(boost::asio::buffer(std::string("ping")));
+    BOOST_CHECK(receive() == "neel: ping");
+    ws.binary(true);
+    ws.write(boost::asio::buffer(std::string(100000, 'x')));
+    BOOST_CHECK(receive() == "neel: " + std::string(100000, 'x'));
+    BOOST_CHECK(!ws.got_text());
+    ws.text(true);
+    
+    // sends beyond the bound of the outgoing queue are refused
+    ws.write(boost::asio::buffer(std::string("burst")));
+    for(int i = 0; i < 4; ++i){
+        BOOST_CHECK(receive() == std::to_string(i));
+    }
+    ws.write(boost::asio::buffer(std::string("accepted")));
+    BOOST_CHECK(receive() == "accepted 4");
+    
+    // the server closes the connection
+    ws.write(boost::asio::buffer(std::string("bye")));
+    boost::beast::flat_buffer buffer;
+    boost::system::error_code ec;
+    ws.read(buffer, ec);
+    BOOST_CHECK(ec == websocket::error::closed);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+/**
+ * reads until the server closes the connection
+ */
+std::string remaining(boost::asio::ip::tcp::socket& socket){
+    std::string received;
+    boost::system::error_code ec;
+    boost::asio::read(socket, boost::asio::dynamic_buffer(received), ec);
+    return received;
+}
+
+BOOST_AUTO_TEST_CASE(draining){
+    running server(19314);
+    std::string small = server.write("small.txt", 5);
+    auto router = udho::router() | (udho::get(&delayed).deferred() = "^/delayed/(\\d+)$");
+    server.serve(router);
+    
+    boost::asio::io_context io;
+    boost::asio::ip::tcp::endpoint endpoint(boost::asio::ip::make_address("127.0.0.1"), 19314);
+    boost::asio::ip::tcp::socket idle(io), busy(io);
+    idle.connect(endpoint);
+    boost::asio::write(idle, boost::asio::buffer(std::string("GET /small.txt HTTP/1.1\r\nHost: localhost\r\n\r\n")));
+    boost::beast::flat_buffer buffer;
+    http::response<http::string_body> res;
+    http::read(idle, buffer, res);
+    BOOST_CHECK(res.keep_alive());
+    busy.connect(endpoint);
+    boost::asio::write(busy, boost::asio::buffer(std::string("GET /delayed/300 HTTP/1.1\r\nHost: localhost\r\n\r\n")));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    BOOST_CHECK(server._server.live() == 2);
+    
+    // the idle connection is closed right away, the in-flight request is answered with Connection: close
+    server._server.drain();
+    BOOST_CHECK(remaining(idle).empty());
+    boost::system::error_code ec;
+    boost::asio::ip::tcp::socket late(io);
+    late.connect(endpoint, ec);
+    BOOST_CHECK(ec);
+    std::string received = remaining(busy);
+    BOOST_CHECK(received.find("delayed 300") != std::string::npos);
+    BOOST_CHECK(received.find("Connection: close") != std::string::npos);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    BOOST_CHECK(server._server.live() == 0);
+    BOOST_CHECK(server._pool.context(0).stopped());
+    
+    // the io_context stops at the drain deadline even if requests are still in flight
+    running hurried(19315);
+    hurried._server[udho::configs::timeouts::drain] = std::chrono::milliseconds(100);
+    hurried.serve(router);
+    boost::asio::ip::tcp::socket stuck(io);
+    stuck.connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), 19315));
+    boost::asio::write(stuck, boost::asio::buffer(std::string("GET /delayed/5000 HTTP/1.1\r\nHost: localhost\r\n\r\n")));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    hurried._server.drain();
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    BOOST_CHECK(hurried._pool.context(0).stopped());
+    BOOST_CHECK(hurried._server.live() == 1);
+}
+
+BOOST_AUTO_TEST_CASE(admission_control){
+    running server(19316);
+    server._server[udho::configs::admission::connections] = 1;
+    std::string small = server.write("small.txt", 5);
+    auto router = udho::router()
+        | (udho::get(&delayed).deferred() = "^/delayed/(\\d+)$")
+        | (udho::get(&slow).plain().blocking() = "^/slow/(-?\\d+)$");
+    server.serve(router);
+    udho::metrics& metrics = server._server._attachment.aux().metrics();
+    
+    // accepting pauses while the only allowed connection is open and resumes once it closes
+    boost::asio::io_context io;
+    boost::asio::ip::tcp::socket first(io), second(io);
+    first.connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), 19316));
+    boost::asio::write(first, boost::asio::buffer(std::string("GET /small.txt HTTP/1.1\r\nHost: localhost\r\n\r\n")));
+    boost::beast::flat_buffer buffer;
+    http::response<http::string_body> res;
+    http::read(first, buffer, res);
+    BOOST_CHECK(res.body() == small);
+    second.connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), 19316));
+    boost::asio::write(second, boost::asio::buffer(std::string("GET /small.txt HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n")));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    BOOST_CHECK(metrics[udho::metrics::paused_accepts] == 1);
+    BOOST_CHECK(server._server.live() == 1);
+    first.close();
+    BOOST_CHECK(remaining(second).find(small) != std::string::npos);
+    
+    // requests beyond the in-flight limit are answered right away with 503 and Retry-After
+    running limited(19317);
+    limited._server[udho::configs::admission::requests]    = 1;
+    limited._server[udho::configs::admission::retry_after] = std::chrono::seconds(2);
+    limited.write("small.txt", 5);
+    limited.serve(router);
+    auto request = [](unsigned short port, const std::string& target){
+        return std::async(std::launch::async, [port, target](){
+            return fetch(port, {get(target)}).front();
+        });
+    };
+    auto busy = request(19317, "/delayed/200");
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    auto rejected = fetch(19317, {get("/small.txt")}).front();
+    BOOST_CHECK(rejected.result() == http::status::service_unavailable);
+    BOOST_CHECK(rejected[http::field::retry_after] == "2");
+    BOOST_CHECK(busy.get().body() == "delayed 200");
+    BOOST_CHECK(fetch(19317, {get("/small.txt")}).front().body() == small);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    BOOST_CHECK(limited._server._attachment.aux().admission().inflight() == 0);
+    BOOST_CHECK(limited._server._attachment.aux().metrics()[udho::metrics::shed_requests] == 1);
+    
+    // the request that waited in the worker queue above the target for longer than the interval is shed
+    running delayed_queue(19318);
+    delayed_queue._server[udho::configs::workers::threads]    = 1;
+    delayed_queue._server[udho::configs::admission::target]   = std::chrono::milliseconds(20);
+    delayed_queue._server[udho::configs::admission::interval] = std::chrono::milliseconds(30);
+    delayed_queue.serve(router);
+    std::vector<std::future<http::response<http::string_body>>> responses;
+    for(int i = 0; i < 3; ++i){
+        responses.push_back(request(19318, "/slow/60"));
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    BOOST_CHECK(responses[0].get().body() == "slept 60");
+    BOOST_CHECK(responses[1].get().body() == "slept 60");
+    BOOST_CHECK(responses[2].get().result() == http::status::service_unavailable);
+    BOOST_CHECK(delayed_queue._server._attachment.aux().admission().shedding());
+    BOOST_CHECK(delayed_queue._server._attachment.aux().metrics()[udho::metrics::shed_requests] == 1);
+}
+
+BOOST_AUTO_TEST_CASE(endpoints){
+    running server(19319);
+    std::string small = server.write("small.txt", 5);
+    boost::filesystem::path path = server._docroot / "http.sock";
+    auto router = udho::router() | (udho::get(&records).json() = "^/records/(\\d+)$");
+    server._server.serve(router, server._pool, {
+        udho::endpoint::tcp4(19319, "127.0.0.1").nodelay().backlog(64).defer_accept(std::chrono::seconds(1)).fastopen(16),
+        udho::endpoint::tcp6(19319, "::1").nodelay(),
+        udho::endpoint::local(path.string(), 0660)
+    });
+    server._pool.start();
+    
+    BOOST_CHECK(fetch(19319, {get("/small.txt")}).front().body() == small);
+    
+    boost::asio::io_context io;
+    boost::asio::ip::tcp::socket ipv6(io);
+    ipv6.connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::make_address("::1"), 19319));
+    auto request = get("/records/2");
+    request.keep_alive(false);
+    http::write(ipv6, request);
+    boost::beast::flat_buffer buffer;
+    http::response<http::string_body> res;
+    http::read(ipv6, buffer, res);
+    BOOST_CHECK(res.body() == json_records(2));
+    
+    BOOST_CHECK((boost::filesystem::status(path).permissions() & boost::filesystem::all_all) == 0660);
+    boost::asio::local::stream_protocol::socket local(io);
+    local.connect(boost::asio::local::stream_protocol::endpoint(path.string()));
+    http::write(local, request);
+    boost::beast::flat_buffer local_buffer;
+    http::response<http::string_body> local_res;
+    http::read(local, local_buffer, local_res);
+    BOOST_CHECK(local_res.body() == json_records(2));
+}
+
+BOOST_AUTO_TEST_CASE(common_headers){
+    running server(19320);
+    std::string small = server.write("small.txt", 5);
+    auto router = udho::router() | (udho::get(&records).json() = "^/records/(\\d+)$");
+    server.serve(router);
+    
+    auto responses = fetch(19320, {get("/small.txt"), get("/records/2"), get("/missing.txt")});
+    BOOST_REQUIRE(responses.size() == 3);
+    for(const auto& res: responses){
+        BOOST_CHECK(res[http::field::server] == UDHO_VERSION_STRING);
+        BOOST_CHECK(res[http::field::date].size() == 29);
+        BOOST_CHECK(res[http::field::date].ends_with(" GMT"));
+    }
+    BOOST_CHECK(responses[1][http::field::content_type] == "application/json");
+    
+    std::time_t parsed;
+    BOOST_CHECK(udho::internal::parse_http_date(udho::headers::date().to_string(), parsed));
+    BOOST_CHECK(std::abs(std::difftime(std::time(nullptr), parsed)) <= 1);
+}
@@ -0,0 +1,22 @@
+#include <string>
+#include <iostream>
+#include <udho/compression.h>
+
+// creates the precompressed .gz (and .br when built with brotli) siblings of the compressible files of a document root
+// usage: udho-precompress <document root> [minimum file size in bytes]
+
+int main(int argc, char** argv){
+    if(argc < 2){
+        std::cerr << "usage: " << argv[0] << " <document root> [minimum file size in bytes]" << std::endl;
+        return 1;
+    }
+    boost::filesystem::path root(argv[1]);
+    if(!boost::filesystem::is_directory(root)){
+        std::cerr << root << " is not a directory" << std::endl;
+        return 1;
+    }
+    std::size_t min_size = argc > 2 ? std::stoul(argv[2]) : 256;
+    std::size_t written = udho::compression::precompress(root, min_size);
+    std::cout << written << " compressed files written in " << root << std::endl;
+    return 0;
+}